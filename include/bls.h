@@ -2,6 +2,7 @@
 #ifndef BLS_LABSTAT_H
 #define BLS_LABSTAT_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 #define BLS_LABSTAT_SERIES "https://download.bls.gov/pub/time.series/"
@@ -17,6 +18,12 @@
 #define BLS_VALUE_PRECISION  3
 #define BLS_FOOTNOTES_LENGTH 10
 #define BLS_DATE_LENGTH      10
+#define BLS_LINE_LENGTH      127
+#define BLS_ETAG_LENGTH      127
+#define BLS_MODIFIED_LENGTH  31  /*< HTTP-date */
+
+#define BLS_API_SERIES_MAX   25  /*< series per API request */
+#define BLS_API_YEARS        10  /*< years per API request */
 
 #define BLS_SERIES_ID_CPI_U "CUUR0000SA0"
 #define BLS_SERIES_ID_CPI_W "CWUR0000SA0"
@@ -41,6 +48,36 @@ struct BLSData
 
 typedef void (*bls_data_handler)(void *, const struct BLSData *);
 
-void bls_download(bls_data_handler, void *);
+/* A flat file and the series kept from it */
+struct BLSFile
+{
+  const char *url;
+  const char * const *series;
+  size_t count;
+};
+
+/* Validators of a flat file, sent back to revalidate it */
+struct BLSValidator
+{
+  char etag[BLS_ETAG_LENGTH + 1];
+  char modified[BLS_MODIFIED_LENGTH + 1];
+};
+
+/**
+ * What a refresh already holds, kept by the caller (see hdb): load and save
+ * the validators of a flat file, and since returns the latest year held of
+ * a series, 0 if none.  Files whose series are all held are revalidated
+ * with a bodiless conditional request, and if changed, only their newest
+ * years are fetched through the API.  Others are downloaded in full.
+ */
+struct BLSCache
+{
+  void (*load)(void *, const char *, struct BLSValidator *);
+  void (*save)(void *, const char *, const struct BLSValidator *);
+  int  (*since)(void *, const char *);
+};
+
+void bls_download_files(const struct BLSFile *, size_t, const struct BLSCache *, bls_data_handler, void *);
+void bls_download(const struct BLSCache *, bls_data_handler, void *);
 
 #endif
@@ -100,6 +100,18 @@
 #define COLOR_PAIR_BOOL(b)                      \
   ((b) ? COLOR_PAIR_TRUE : COLOR_PAIR_FALSE)
 
+/* Quote members rendered by SPARK_LAYOUT rows and read by the events
+   calendar, requested via fields= */
+#define SPARK_FIELDS                                                    \
+  "shortName,quoteType,marketState,"                                    \
+  "dividendDate,earningsTimestamp,earningsTimestampStart,"              \
+  "regularMarketPrice,regularMarketChange,regularMarketChangePercent,"  \
+  "regularMarketOpen,regularMarketPreviousClose,"                       \
+  "regularMarketDayHigh,regularMarketDayLow,"                           \
+  "regularMarketVolume,regularMarketTime,"                              \
+  "fiftyTwoWeekLow,fiftyTwoWeekLowChange,"                              \
+  "fiftyTwoWeekHigh,fiftyTwoWeekHighChange"
+
 #define IS_PRE(m)     (strncmp(m, "PRE", 3)     == 0)
 #define IS_REGULAR(m) (strncmp(m, "REGULAR", 7) == 0)
 #define IS_POST(m)    (strncmp(m, "POST", 4)    == 0)
@@ -148,7 +160,6 @@ struct Spark
   struct
   {
     GString *cursym;
-    GString *query;
     int64_t  startDate;
     int64_t  endDate;
     char    *events;
@@ -11,6 +11,9 @@
 #define HDB_OK     0
 #define HDB_ERROR -1
 
+#define HDB_BUSY_TIMEOUT 5000  /*< milliseconds to wait for another connection's transaction */
+#define HDB_BATCH_ROWS   10000 /*< rows held by a bulk download before they are written */
+
 #define CREATE_HISTORY "CREATE TABLE IF NOT EXISTS YHistory ("  \
   " Symbol    TEXT(32),"                                        \
   " Timestamp INTEGER(8),"                                      \
@@ -30,6 +33,24 @@
   " ON CONFLICT (Symbol, Timestamp)"                                    \
   " DO NOTHING"
 
+#define CREATE_FUNDAMENTAL "CREATE TABLE IF NOT EXISTS YFundamental (" \
+  " Symbol    TEXT(32),"                                            \
+  " Frequency INTEGER(1),"                                          \
+  " Type      TEXT(32),"                                            \
+  " Date      TEXT(10),"                                            \
+  " Value     REAL,"                                                \
+  " PRIMARY KEY(Symbol, Frequency, Type, Date)"                     \
+  ");"
+
+#define UPSERT_FUNDAMENTAL "INSERT INTO YFundamental"  \
+  " (Symbol, Frequency, Type, Date, Value)"            \
+  " VALUES (?1, ?2, ?3, ?4, ?5)"                       \
+  " ON CONFLICT (Symbol, Frequency, Type, Date)"       \
+  " DO UPDATE SET Value = ?5"
+
+#define SELECT_FUNDAMENTAL "SELECT Symbol, Frequency, Type, Date, Value FROM YFundamental" \
+  " ORDER BY Symbol, Frequency, Date"
+
 #define CREATE_SERIES "CREATE TABLE IF NOT EXISTS BLSSeries ("  \
   " Series TEXT(32),"                                           \
   " Year   INTEGER(2),"                                         \
@@ -43,7 +64,23 @@
   " (Series, Year, Period, Value, Date)"        \
   " VALUES (?1, ?2, ?3, ?4, ?5)"                \
   " ON CONFLICT (Series, Year, Period)"         \
-  " DO NOTHING"
+  " DO UPDATE SET Value = ?4, Date = ?5"
+
+#define SELECT_SERIES_SINCE "SELECT MAX(Year) FROM BLSSeries WHERE Series = ?1"
+
+#define CREATE_VALIDATOR "CREATE TABLE IF NOT EXISTS BLSValidator ("     \
+  " Url          TEXT PRIMARY KEY,"                                      \
+  " ETag         TEXT,"                                                  \
+  " LastModified TEXT"                                                   \
+  ");"
+
+#define UPSERT_VALIDATOR "INSERT INTO BLSValidator"     \
+  " (Url, ETag, LastModified)"                          \
+  " VALUES (?1, ?2, ?3)"                                \
+  " ON CONFLICT (Url)"                                  \
+  " DO UPDATE SET ETag = ?2, LastModified = ?3"
+
+#define SELECT_VALIDATOR "SELECT ETag, LastModified FROM BLSValidator WHERE Url = ?1"
 
 #define SELECT_SERIES       "SELECT Series, Year, Period, Value, Date FROM BLSSeries"
 #define SELECT_SERIES_M     SELECT_SERIES " WHERE Period BETWEEN 'M01' AND 'M12'"
@@ -57,6 +94,7 @@ struct hdb_t
   char *dbpath;
   sqlite3 *db;
   sqlite3_stmt *upsert_history;
+  sqlite3_stmt *upsert_fundamental;
   sqlite3_stmt *upsert_series;
   char *errmsg;
 };
@@ -67,6 +105,11 @@ void hdb_close(struct hdb_t *);
 
 void hdb_upsert_history(struct hdb_t *, const struct YHistory * const);
 void hdb_upsert_histories(struct hdb_t *, const YArray * const);
+int  hdb_download_histories(struct hdb_t *, const char **, size_t, struct YDownload *);
+
+void *hdb_collect_fundamentals(const struct hdb_t *, const char **, size_t);
+void *hdb_save_fundamentals(void *);
+void hdb_select_fundamentals(struct hdb_t *);
 
 void hdb_upsert_series(struct hdb_t *, const struct BLSData * const);
 void *hdb_download_series(void *);
@@ -0,0 +1,81 @@
+#pragma once
+#ifndef HTTP_H
+#define HTTP_H
+
+#include <stdint.h>
+
+#include <curl/curl.h>
+
+#define HTTP_OK     0
+#define HTTP_ERROR -1
+#define HTTP_AGAIN  1 /*< throttled or retryable, see wait */
+#define HTTP_BROKEN 2 /*< circuit open, serve cached data */
+
+#define HTTP_DNS_CACHE_TIMEOUT 600L /*< seconds */
+#define HTTP_KEEPIDLE          60L  /*< seconds */
+#define HTTP_KEEPINTVL         30L  /*< seconds */
+#define HTTP_MAXAGE_CONN       300L /*< seconds */
+#define HTTP_MAX_HOST_CONNS    6L
+
+#define HTTP_MAX_HOSTS         8
+#define HTTP_HOST_LENGTH       63
+#define HTTP_RATE              8.0     /*< requests per second */
+#define HTTP_RATE_MIN          0.5
+#define HTTP_RATE_MAX          32.0
+#define HTTP_RATE_STEP         0.25    /*< additive increase per success */
+#define HTTP_BURST             8.0     /*< tokens */
+#define HTTP_RETRIES           4
+#define HTTP_BACKOFF           500000L /*< microseconds */
+#define HTTP_BACKOFF_MAX       30000000L
+#define HTTP_BREAKER_FAILURES  5
+#define HTTP_BREAKER_COOLDOWN  30000000L
+#define HTTP_EWMA              0.2     /*< weight of the newest sample */
+#define HTTP_ERROR_PENALTY     4.0
+#define HTTP_EXPLORE           10000000L /*< microseconds before an idle host is retried */
+
+/* Record/replay transport, configured from the environment by http_init() */
+#define HTTP_RECORD_ENV        "GAMMATERM_RECORD"    /*< directory to record responses to */
+#define HTTP_REPLAY_ENV        "GAMMATERM_REPLAY"    /*< directory to replay responses from */
+#define HTTP_LATENCY_ENV       "GAMMATERM_LATENCY"   /*< simulated replay latency, milliseconds */
+#define HTTP_BANDWIDTH_ENV     "GAMMATERM_BANDWIDTH" /*< simulated replay bandwidth, bytes per second */
+#define HTTP_ORIGIN_ENV        "GAMMATERM_ORIGIN"    /*< scheme://host:port serving every request, see yqld */
+#define HTTP_PATH_LENGTH       4095
+
+#define HTTP_BUFFER_MIN        16384   /*< bytes, first allocation of a response buffer */
+#define HTTP_BUFFER_KEEP       4194304 /*< bytes, larger buffers are freed rather than pooled */
+#define HTTP_BUFFER_POOL       16      /*< idle buffers kept for reuse */
+
+/**
+ * Response body, NUL terminated.  Storage comes from a process-wide pool
+ * and grows geometrically, so steady-state polling reuses the same few
+ * blocks instead of allocating per chunk and per request.
+ */
+struct HttpBuffer
+{
+  char   *data;
+  size_t  size;
+  size_t  capacity;
+};
+
+int  http_init();
+void http_free();
+
+CURL  *http_easy_init();
+CURLM *http_multi_init();
+
+void    http_prepare(CURL *easy, const char *url, curl_write_callback write, void *data);
+void    http_prepare_post(CURL *easy, const char *url, const char *body, curl_write_callback write, void *data);
+int64_t http_drain(CURL *easy);
+void    http_drain_wait(CURL *easy);
+int64_t http_latency();
+int     http_admit(const char *url, int64_t *wait);
+int     http_wait(const char *url);
+int     http_report(const char *url, CURL *easy, CURLcode result);
+int64_t http_backoff(CURL *easy, int attempt);
+size_t  http_pick(const char * const *urls, size_t n);
+
+size_t  http_buffer_write(char *p, size_t size, size_t nmemb, void *user);
+void    http_buffer_release(struct HttpBuffer *buffer);
+char   *http_buffer_detach(struct HttpBuffer *buffer);
+
+#endif
@@ -0,0 +1,62 @@
+#pragma once
+#ifndef JSTREAM_H
+#define JSTREAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define JSTREAM_OK     0
+#define JSTREAM_ERROR -1
+
+#define JSTREAM_DEPTH        64   /*< nesting levels */
+#define JSTREAM_TOKEN_LENGTH 1023 /*< longer strings are truncated */
+
+enum JStreamEvent
+{
+  JSTREAM_OBJECT,
+  JSTREAM_OBJECT_END,
+  JSTREAM_ARRAY,
+  JSTREAM_ARRAY_END,
+  JSTREAM_KEY,
+  JSTREAM_STRING,
+  JSTREAM_NUMBER,
+  JSTREAM_TRUE,
+  JSTREAM_FALSE,
+  JSTREAM_NULL,
+};
+
+/**
+ * Receives each token as it completes.  Keys, strings and numbers come with
+ * their text, NUL terminated; a non-zero return stops the stream.
+ */
+typedef int (*jstream_handler)(void *, enum JStreamEvent, const char *, size_t);
+
+/**
+ * Push tokenizer: the document is fed in chunks of any size, tokens split
+ * across chunks are carried over, and nothing but the current token and
+ * the nesting of containers is kept.
+ */
+struct JStream
+{
+  jstream_handler handler;
+  void    *user;
+  int      state;
+  int      expect;
+  bool     first;  /*< container just opened, may close at once */
+  int      depth;
+  uint64_t arrays; /*< bit i set if level i is an array */
+  char     token[JSTREAM_TOKEN_LENGTH + 1];
+  size_t   length;
+  uint32_t code;   /*< \u escape being decoded */
+  uint32_t high;   /*< pending high surrogate */
+  int      digits;
+  const char *literal;
+  size_t   offset; /*< bytes consumed, for error reporting */
+};
+
+void jstream_init(struct JStream *, jstream_handler, void *);
+int  jstream_feed(struct JStream *, const char *, size_t);
+int  jstream_end(struct JStream *);
+
+#endif
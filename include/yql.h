@@ -18,8 +18,27 @@
 #define Y_INSIGHTS     Y_HOST1 "ws/insights/v2/finance/insights"
 #define Y_TIMESERIES   Y_HOST1 "ws/fundamentals-timeseries/v1/finance/timeseries"
 #define Y_HEADLINE     "https://feeds.finance.yahoo.com/rss/2.0/headline"
+#define Y_STREAMER     "wss://streamer.finance.yahoo.com/?version=2"
 
+#define YTTL_QUOTE        15L    /*< seconds */
+#define YTTL_CHART        60L
+#define YTTL_OPTIONS      300L
+#define YTTL_HEADLINE     600L
+#define YTTL_QUOTESUMMARY 86400L
+#define YTTL_TIMESERIES   86400L
+
+#define YURL_LENGTH    2048
+#define YSPARK_SYMBOLS 20
 #define YARRAY_LENGTH  64
+#define YDOWNLOAD_PARALLEL 16 /*< transfers in flight in a bulk download */
+#define YFUNDAMENTAL_PERIODS 8 /*< latest periods kept per frequency */
+#define YFUNDAMENTAL_YEARS   5 /*< history fetched for a symbol not held yet */
+#define YSTREAM_ENV         "GAMMATERM_STREAM" /*< streamer URL, file:// replay, or "off" */
+#define YSTREAM_MESSAGES    64        /*< read per yql_poll(), paces a replay */
+#define YSTREAM_LENGTH      4095      /*< bytes, longer messages are dropped */
+#define YSTREAM_TIMEOUT     5000L     /*< milliseconds to connect and upgrade */
+#define YSTREAM_BACKOFF     1000000L  /*< microseconds before reconnecting */
+#define YSTREAM_BACKOFF_MAX 60000000L
 #define YDATE_LENGTH   10
 #define YSTRING_LENGTH 31
 #define YTEXT_LENGTH   127
@@ -60,6 +79,20 @@ typedef enum YErrorCode
   YERROR_NERR = 0, YERROR_CERR, YERROR_CURL, YERROR_JSON, YERROR_XML, YERROR_YHOO,
 } YErrorCode;
 
+/* quoteSummary modules with a parser, one bit per struct YQuoteSummary section */
+enum YModule
+{
+  YMODULE_ASSET_PROFILE          = 1 << 0,
+  YMODULE_CALENDAR_EVENTS        = 1 << 1,
+  YMODULE_DEFAULT_KEY_STATISTICS = 1 << 2,
+  YMODULE_EARNINGS               = 1 << 3,
+  YMODULE_EARNINGS_HISTORY       = 1 << 4,
+  YMODULE_EARNINGS_TREND         = 1 << 5,
+  YMODULE_FINANCIAL_DATA         = 1 << 6,
+  YMODULE_TOP_HOLDINGS           = 1 << 7,
+  YMODULES                       = 8,
+};
+
 struct YError
 {
   YString response;
@@ -420,6 +453,7 @@ struct YChart
   YString symbol;
   /*   YString validRanges[0]; */
   /* } meta; */
+  bool    closeOnly;          /*< filled by yql_spark: open/high/low flattened, no volume */
 
   size_t  count;
   int64_t timestamp[YARRAY_LENGTH];
@@ -495,6 +529,59 @@ struct YOptionChain
   /* } options[EXPIRATION_DATES]; */
 };
 
+enum YFrequency
+{
+  YFREQUENCY_ANNUAL, YFREQUENCY_QUARTERLY, YFREQUENCIES
+};
+
+/* Fundamentals fetched from the timeseries endpoint, each as annual<n> and quarterly<n> */
+#define YFUNDAMENTAL_TYPES(X)    \
+  X(TotalRevenue)                \
+  X(GrossProfit)                 \
+  X(OperatingIncome)             \
+  X(EBITDA)                      \
+  X(NetIncome)                   \
+  X(DilutedEPS)                  \
+  X(DilutedAverageShares)        \
+  X(OperatingCashFlow)           \
+  X(CapitalExpenditure)          \
+  X(FreeCashFlow)                \
+  X(CashAndCashEquivalents)      \
+  X(TotalAssets)                 \
+  X(TotalDebt)                   \
+  X(StockholdersEquity)
+
+#define YFUNDAMENTAL_ENUM(n) YFUNDAMENTAL_##n,
+enum YFundamental
+{
+  YFUNDAMENTAL_TYPES(YFUNDAMENTAL_ENUM) YFUNDAMENTALS
+};
+#undef YFUNDAMENTAL_ENUM
+
+/**
+ * Fundamentals of every symbol fetched, stored column by column so a screen
+ * across symbols reads contiguous memory.  Row r holds symbols[r]; at
+ * frequency f it has counts[f][r] periods, oldest first, and period p ends
+ * on dates[f][r * YFUNDAMENTAL_PERIODS + p].  Values not reported are NAN.
+ * asOfDates[r] is the latest period end held at every frequency, from which
+ * a refresh of the row resumes, and changed[r] tells whether the row needs
+ * saving.
+ */
+struct YFundamentals
+{
+  size_t   rows;
+  size_t   capacity;
+  YString *symbols;
+  YDate   *asOfDates;
+  bool    *changed;   /*< stored to since last saved */
+  uint8_t *counts[YFREQUENCIES];
+  YDate   *dates[YFREQUENCIES];
+  double  *values[YFREQUENCIES][YFUNDAMENTALS];
+};
+
+#define YFundamentals_date(F, f, r, p)     ((F)->dates[f][(r) * YFUNDAMENTAL_PERIODS + (p)])
+#define YFundamentals_value(F, f, t, r, p) ((F)->values[f][t][(r) * YFUNDAMENTAL_PERIODS + (p)])
+
 struct YHistory
 {
   double  adjclose;
@@ -508,6 +595,25 @@ struct YHistory
   const char *symbol;
 };
 
+/**
+ * Bulk history download: every symbol's CSV is written to the file open()
+ * returns for it, if set, and its rows are handed to row() as they are
+ * parsed, if set.  A transfer that is retried calls open() again, so files
+ * must be opened for writing from the start; they are closed by the
+ * downloader.  done() is called once per symbol with its status.
+ */
+struct YDownload
+{
+  int64_t     period1;
+  int64_t     period2;
+  const char *interval;
+  size_t      parallel; /*< 0 for YDOWNLOAD_PARALLEL */
+  FILE     *(*open)(void *, const char *);
+  void      (*row)(void *, const struct YHistory *);
+  int       (*done)(int, const char *);
+  void       *user;
+};
+
 struct YHeadline
 {
 /* #define HEADLINES 20 */
@@ -533,22 +639,40 @@ struct YChart *yql_chart_get(const char *);
 struct YOptionChain *yql_optionChain_get(const char *);
 struct YHeadline *yql_headline_get(const char *);
 struct YHeadline *yql_headline_at(const char *, size_t);
+const struct YFundamentals *yql_fundamentals_get();
+long yql_fundamentals_row(const char *);
+const char *yql_fundamental_name(enum YFundamental);
+int  yql_fundamental_type(const char *);
+void yql_fundamentals_put(const char *, enum YFrequency, enum YFundamental, const char *, double);
+void yql_fundamentals_saved(long);
 
 void yql_quote_foreach(void (*)(void *, void *, void *), void *);
 
+int yql_multi_begin();
+int yql_multi_end(int (*)(int, const char *));
+int yql_poll(int (*)(int, const char *));
+void yql_invalidate();
+
+int  yql_stream_open(const char *);
+void yql_stream_close();
+int  yql_stream_subscribe(const char **, size_t);
+
 int yql_quote(const char *);
-int yql_quoteSummary(const char *);
-int yql_earnings(const char *);
-int yql_financials(const char *);
-int yql_holdings(const char *);
+int yql_quote_batch(const char **, size_t, const char *);
+int yql_quoteSummary(const char *, unsigned);
 int yql_chart(const char *);
+int yql_chart_update(const char *);
 int yql_chart_range(const char *, int64_t, int64_t, const char *);
+int yql_spark(const char **, size_t);
 int yql_options(const char *);
 int yql_options_series(const char *, int64_t);
 int yql_options_series_k(const char *, double);
 int yql_download_r(const char *, int64_t, int64_t, const char *, char **, size_t *);
 int yql_download_h(const char *, int64_t, int64_t, const char *, YArray *);
 int yql_download_f(const char *, int64_t, int64_t, const char *, FILE *);
+int yql_history_h(const char *, const char *, size_t, YArray *);
+int yql_download_m(const char **, size_t, const struct YDownload *);
 int yql_headline(const char *);
+int yql_timeseries(const char **, size_t);
 
 #endif
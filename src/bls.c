@@ -1,100 +1,421 @@
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <time.h>
 
 #include <curl/curl.h>
 
 #include "../include/bls.h"
+#include "../include/http.h"
+#include "../include/jstream.h"
 
-typedef struct buf_t
+#define BLS_OK            0
+#define BLS_ERROR        -1
+#define BLS_NOT_MODIFIED  1
+
+#define BLS_KEY_LENGTH    15
+
+#define _U_ __attribute__ ((__unused__))
+
+/**
+ * Flat files are parsed as they download: line and field boundaries are
+ * found with memchr, only the series of interest are decoded, and only a
+ * line split across chunks is ever copied.
+ */
+struct BLSStream
 {
-  char   *data;
-  size_t  size;
-} buf_t;
+  const struct BLSFile *file;
+  bls_data_handler callback;
+  void   *user;
+  size_t  lines;
+  size_t  len;
+  char    line[BLS_LINE_LENGTH + 1]; /*< partial line carried between chunks */
+};
 
-static size_t callback(char *p, size_t size, size_t nmemb, void *user)
+/* Returns the next tab separated field, trimmed of padding, or NULL past the last */
+static const char *bls_field(const char **p, const char *end, size_t *n)
 {
-  size_t nsize = size * nmemb;
-  buf_t *buf = user;
-  buf->data = realloc(buf->data, buf->size + nsize + 1);
-  if (!buf->data) {
-    /* log_error(logger, "%s:%d: realloc(%zu): %s\n", __FILE__, __LINE__, nsize, strerror(errno)); */
-    return 0;
-  }
-  memcpy(&buf->data[buf->size], p, nsize);
-  buf->size += nsize;
-  buf->data[buf->size] = 0;
-  return nsize;
+  const char *q = *p;
+  if (q >= end) {
+    return NULL;
+  }
+  const char *t = memchr(q, '\t', end - q);
+  const char *e = t ? t : end;
+  *p = t ? t + 1 : end;
+  while (q < e && *q == ' ') {
+    q++;
+  }
+  while (e > q && e[-1] == ' ') {
+    e--;
+  }
+  *n = e - q;
+  return q;
 }
 
-static void bls_parse(const buf_t *buf, const char *series, bls_data_handler c, void *u)
+static void bls_date(struct BLSData *d)
 {
-  char *data = buf->data;
-  while (data && *data++ != 0x0A); /* Skip header */
+  if (*d->period == BLS_PERIOD_MONTHLY && strncmp(d->period, BLS_PERIOD_AN_AV, BLS_PERIOD_LENGTH) < 0) {
+    sprintf(d->date, "%04d-%2.2s-01", d->year, d->period + 1);
+  } else {
+    strncpy(d->date, BLS_DATE_NULL, BLS_DATE_LENGTH + 1);
+  }
+}
 
-  for (char *tok = data, *savetok = NULL; ; tok = NULL) {
-    if (!(tok = strtok_r(tok, BLS_RECORD_DELIM, &savetok))) {
-      break;
+static bool bls_series(const struct BLSFile *f, const char *s, size_t n)
+{
+  for (size_t i = 0; i < f->count; i++) {
+    if (strlen(f->series[i]) == n && memcmp(f->series[i], s, n) == 0) {
+      return true;
     }
+  }
+  return false;
+}
 
-    struct BLSData d;
-    int col = 0;
-    for (char *sub = tok, *savesub = NULL; ; sub = NULL, col++) {
-      if (!(sub = strtok_r(sub, BLS_FIELD_DELIM, &savesub))) {
-        if (col >= 4) {
-          c(u, &d);
-        }
-      BREAK_SUB:
-        break;
-      }
-      switch (col) {
-      case 0:
-        if (strncmp(sub, series, BLS_SERIES_ID_LENGTH) != 0) {
-          goto BREAK_SUB;
-        }
-        strncpy(d.series, sub, BLS_SERIES_ID_LENGTH);
-        break;
-      case 1:
-        d.year = atoi(sub);
-        break;
-      case 2:
-        strncpy(d.period, sub, BLS_PERIOD_LENGTH);
-
-        if (*d.period == BLS_PERIOD_MONTHLY && strncmp(d.period, BLS_PERIOD_AN_AV, BLS_PERIOD_LENGTH) < 0) {
-          sprintf(d.date, "%04d-%2.2s-01", d.year, d.period + 1);
-        } else {
-          strncpy(d.date, BLS_DATE_NULL, BLS_DATE_LENGTH + 1);
-        }
-        break;
-      case 3:
-        d.value = atof(sub);
+static void bls_line(struct BLSStream *b, const char *p, size_t n)
+{
+  if (n && p[n - 1] == '\r') {
+    n--;
+  }
+  if (b->lines++ == 0) {
+    return; /* Skip header */
+  }
+
+  const char *end = p + n, *series = NULL, *year = NULL, *period = NULL, *value = NULL;
+  size_t nseries = 0, nyear = 0, nperiod = 0, nvalue = 0;
+  if (!(series = bls_field(&p, end, &nseries)) || nseries > BLS_SERIES_ID_LENGTH || !bls_series(b->file, series, nseries)) {
+    return;
+  }
+  if (!(year = bls_field(&p, end, &nyear)) || !(period = bls_field(&p, end, &nperiod)) || !(value = bls_field(&p, end, &nvalue))) {
+    return;
+  }
+
+  struct BLSData d;
+  memcpy(d.series, series, nseries);
+  d.series[nseries] = '\0';
+
+  d.year = 0;
+  for (size_t i = 0; i < nyear && i < BLS_YEAR_LENGTH && year[i] >= '0' && year[i] <= '9'; i++) {
+    d.year = d.year * 10 + (year[i] - '0');
+  }
+
+  nperiod = nperiod < BLS_PERIOD_LENGTH ? nperiod : BLS_PERIOD_LENGTH;
+  memcpy(d.period, period, nperiod);
+  d.period[nperiod] = '\0';
+  bls_date(&d);
+
+  char v[BLS_VALUE_LENGTH + 1];
+  nvalue = nvalue < BLS_VALUE_LENGTH ? nvalue : BLS_VALUE_LENGTH;
+  memcpy(v, value, nvalue);
+  v[nvalue] = '\0';
+  d.value = atof(v);
+
+  b->callback(b->user, &d);
+}
+
+static size_t bls_write(char *p, size_t size, size_t nmemb, void *user)
+{
+  struct BLSStream *b = user;
+  size_t nsize = size * nmemb;
+  for (const char *q = p, *end = p + nsize; q < end; ) {
+    const char *nl = memchr(q, '\n', end - q);
+    size_t k = (nl ? nl : end) - q;
+    if (nl && !b->len) {
+      bls_line(b, q, k);
+    } else {
+      k = k < BLS_LINE_LENGTH - b->len ? k : BLS_LINE_LENGTH - b->len;
+      memcpy(b->line + b->len, q, k);
+      b->len += k;
+      if (!nl) {
         break;
       }
+      bls_line(b, b->line, b->len);
+      b->len = 0;
     }
+    q = nl + 1;
   }
+  return nsize;
 }
 
-static void bls_query(const char *url, const char *series, bls_data_handler c, void *u)
+static size_t bls_discard(char *p _U_, size_t size, size_t nmemb, void *user _U_)
 {
-  buf_t buf = { .data = NULL, .size = 0 };
+  return size * nmemb;
+}
 
-  curl_global_init(CURL_GLOBAL_ALL);
+static void bls_header_value(const char *p, size_t n, const char *name, char *v, size_t max)
+{
+  size_t k = strlen(name);
+  if (n < k || strncasecmp(p, name, k) != 0) {
+    return;
+  }
+  for (p += k, n -= k; n && (*p == ' ' || *p == '\t'); p++, n--);
+  for ( ; n && (p[n - 1] == '\r' || p[n - 1] == '\n' || p[n - 1] == ' '); n--);
+  n = n < max ? n : max;
+  memcpy(v, p, n);
+  v[n] = '\0';
+}
 
-  CURL *easy = curl_easy_init();
-  curl_easy_setopt(easy, CURLOPT_URL, url);
-  curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, callback);
-  curl_easy_setopt(easy, CURLOPT_WRITEDATA, &buf);
-  curl_easy_perform(easy);
-  curl_easy_cleanup(easy);
+static size_t bls_header(char *p, size_t size, size_t nmemb, void *user)
+{
+  struct BLSValidator *v = user;
+  size_t n = size * nmemb;
+  bls_header_value(p, n, "ETag:", v->etag, BLS_ETAG_LENGTH);
+  bls_header_value(p, n, "Last-Modified:", v->modified, BLS_MODIFIED_LENGTH);
+  return n;
+}
+
+/**
+ * GETs url, or only its headers if write is NULL, conditionally on the
+ * validators in v.  On success v holds the validators of the response.
+ */
+static int bls_request(CURL *easy, const char *url, struct BLSValidator *v, curl_write_callback write, void *data)
+{
+  if (http_wait(url) != HTTP_OK) {
+    return BLS_ERROR;
+  }
+
+  char line[BLS_ETAG_LENGTH + 32];
+  struct curl_slist *headers = NULL;
+  if (*v->etag) {
+    snprintf(line, sizeof(line), "If-None-Match: %s", v->etag);
+    headers = curl_slist_append(headers, line);
+  }
+  if (*v->modified) {
+    snprintf(line, sizeof(line), "If-Modified-Since: %s", v->modified);
+    headers = curl_slist_append(headers, line);
+  }
+
+  struct BLSValidator response = { "", "" };
+  http_prepare(easy, url, write ? write : bls_discard, data);
+  curl_easy_setopt(easy, CURLOPT_NOBODY, write ? 0L : 1L);
+  curl_easy_setopt(easy, CURLOPT_HTTPHEADER, headers);
+  curl_easy_setopt(easy, CURLOPT_HEADERFUNCTION, bls_header);
+  curl_easy_setopt(easy, CURLOPT_HEADERDATA, &response);
+  CURLcode result = curl_easy_perform(easy);
+  http_drain_wait(easy);
+  http_report(url, easy, result);
+
+  long code = 0;
+  curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &code);
+  curl_easy_setopt(easy, CURLOPT_HTTPGET, 1L);
+  curl_easy_setopt(easy, CURLOPT_HTTPHEADER, NULL);
+  curl_easy_setopt(easy, CURLOPT_HEADERFUNCTION, NULL);
+  curl_easy_setopt(easy, CURLOPT_HEADERDATA, NULL);
+  curl_slist_free_all(headers);
 
-  curl_global_cleanup();
+  if (result != CURLE_OK) {
+    return BLS_ERROR;
+  } else if (code == 304) {
+    return BLS_NOT_MODIFIED;
+  } else if (code != 200 && code != 0) { /* 0 for file:// replays */
+    return BLS_ERROR;
+  }
+  *v = response;
+  return BLS_OK;
+}
+
+/* Reads the data points of an API response as it streams in */
+struct BLSJson
+{
+  bls_data_handler callback;
+  void   *user;
+  int     depth;
+  int     data;   /*< depth of data points, 0 outside a "data" array */
+  bool    value;  /*< the data point has a numeric value */
+  bool    failed; /*< status other than REQUEST_SUCCEEDED */
+  char    key[BLS_KEY_LENGTH + 1];
+  struct BLSData d;
+};
+
+static int bls_json_event(void *user, enum JStreamEvent e, const char *s, size_t n _U_)
+{
+  struct BLSJson *j = user;
+  switch (e) {
+  case JSTREAM_ARRAY:
+    j->data = strcmp(j->key, "data") == 0 ? j->depth + 2 : j->data;
+    /* fall through */
+  case JSTREAM_OBJECT:
+    if (++j->depth == j->data) {
+      j->d.year = 0, *j->d.period = '\0', j->value = false;
+    }
+    *j->key = '\0';
+    break;
+  case JSTREAM_OBJECT_END:
+    if (j->depth-- == j->data && *j->d.period && j->value) {
+      bls_date(&j->d);
+      j->callback(j->user, &j->d);
+    }
+    break;
+  case JSTREAM_ARRAY_END:
+    if (j->depth-- == j->data - 1) {
+      j->data = 0;
+    }
+    break;
+  case JSTREAM_KEY:
+    strncpy(j->key, s, BLS_KEY_LENGTH);
+    j->key[BLS_KEY_LENGTH] = '\0';
+    break;
+  case JSTREAM_STRING:
+    if (j->depth == 1 && strcmp(j->key, "status") == 0) {
+      j->failed = strcmp(s, "REQUEST_SUCCEEDED") != 0;
+    } else if (strcmp(j->key, "seriesID") == 0) {
+      strncpy(j->d.series, s, BLS_SERIES_ID_LENGTH);
+      j->d.series[BLS_SERIES_ID_LENGTH] = '\0';
+    } else if (j->depth == j->data && strcmp(j->key, "year") == 0) {
+      j->d.year = atoi(s);
+    } else if (j->depth == j->data && strcmp(j->key, "period") == 0) {
+      strncpy(j->d.period, s, BLS_PERIOD_LENGTH);
+      j->d.period[BLS_PERIOD_LENGTH] = '\0';
+    } else if (j->depth == j->data && strcmp(j->key, "value") == 0) {
+      char *end = NULL;
+      j->d.value = strtod(s, &end);
+      j->value = end != s;
+    }
+    break;
+  default:
+    break;
+  }
+  return 0;
+}
+
+static size_t bls_json_write(char *p, size_t size, size_t nmemb, void *user)
+{
+  jstream_feed(user, p, size * nmemb); /* A malformed body fails at jstream_end() */
+  return size * nmemb;
+}
+
+/* Fetches the data points of up to BLS_API_SERIES_MAX series from year since on */
+static int bls_api(CURL *easy, const char * const *series, size_t n, int since, bls_data_handler c, void *u)
+{
+  time_t now = time(NULL);
+  struct tm tm;
+  gmtime_r(&now, &tm);
+
+  char body[BLS_API_SERIES_MAX * (BLS_SERIES_ID_LENGTH + 3) + 64];
+  size_t len = snprintf(body, sizeof(body), "{\"seriesid\":[");
+  for (size_t i = 0; i < n; i++) {
+    len += snprintf(body + len, sizeof(body) - len, "%s\"%s\"", i ? "," : "", series[i]);
+  }
+  snprintf(body + len, sizeof(body) - len, "],\"startyear\":\"%d\",\"endyear\":\"%d\"}", since, tm.tm_year + 1900);
+
+  if (http_wait(BLS_API_SERIES) != HTTP_OK) {
+    return BLS_ERROR;
+  }
+
+  struct BLSJson b = { .callback = c, .user = u };
+  struct JStream j;
+  jstream_init(&j, bls_json_event, &b);
+  struct curl_slist *headers = curl_slist_append(NULL, "Content-Type: application/json");
+  http_prepare_post(easy, BLS_API_SERIES, body, bls_json_write, &j);
+  curl_easy_setopt(easy, CURLOPT_HTTPHEADER, headers);
+  CURLcode result = curl_easy_perform(easy);
+  http_drain_wait(easy);
+  http_report(BLS_API_SERIES, easy, result);
+  curl_easy_setopt(easy, CURLOPT_HTTPGET, 1L);
+  curl_easy_setopt(easy, CURLOPT_HTTPHEADER, NULL);
+  curl_slist_free_all(headers);
+
+  return result == CURLE_OK && jstream_end(&j) == JSTREAM_OK && !b.failed ? BLS_OK : BLS_ERROR;
+}
+
+static int bls_full(CURL *easy, const struct BLSFile *file, struct BLSValidator *v, bls_data_handler c, void *u)
+{
+  struct BLSStream b = { .file = file, .callback = c, .user = u, .lines = 0, .len = 0 };
 
-  bls_parse(&buf, series, c, u);
-  free(buf.data);
+  int status = bls_request(easy, file->url, v, bls_write, &b);
+  if (b.len) {
+    bls_line(&b, b.line, b.len);
+  }
+  return status;
 }
 
-void bls_download(bls_data_handler callback, void *user)
+/* The latest year held of every series of file, 0 if any is missing */
+static int bls_since(const struct BLSCache *cache, void *u, const struct BLSFile *file)
 {
-  bls_query(BLS_LABSTAT_CPI_U, BLS_SERIES_ID_CPI_U, callback, user);
-  bls_query(BLS_LABSTAT_CPI_W, BLS_SERIES_ID_CPI_W, callback, user);
-  bls_query(BLS_LABSTAT_PPI  , BLS_SERIES_ID_PPI  , callback, user);
+  int since = INT_MAX;
+  for (size_t i = 0; i < file->count && since; i++) {
+    int year = cache->since(u, file->series[i]);
+    since = year < since ? year : since;
+  }
+  return file->count ? since : 0;
+}
+
+/**
+ * Files held in full are revalidated with a HEAD request, which transfers
+ * no body either way.  The series of those that changed are then fetched in
+ * batches through the API, from the latest year held, so revisions of the
+ * newest periods come along.  Their validators are saved only once every
+ * batch succeeded.
+ */
+void bls_download_files(const struct BLSFile *files, size_t n, const struct BLSCache *cache,
+                        bls_data_handler callback, void *user)
+{
+  CURL *easy = http_easy_init(); /* Reuse one keep-alive connection for all flat files */
+  if (!easy) {
+    return;
+  }
+
+  time_t now = time(NULL);
+  struct tm tm;
+  gmtime_r(&now, &tm);
+
+  struct BLSValidator *validators = calloc(n, sizeof(struct BLSValidator));
+  bool *changed = calloc(n, sizeof(bool));
+  const char *series[BLS_API_SERIES_MAX];
+  size_t m = 0;
+  int since = INT_MAX, status = BLS_OK;
+  for (size_t i = 0; validators && changed && i < n; i++) {
+    struct BLSValidator *v = &validators[i];
+    int held = cache ? bls_since(cache, user, &files[i]) : 0;
+    if (held) {
+      cache->load(user, files[i].url, v);
+    }
+    if (!held || (!*v->etag && !*v->modified) || held <= tm.tm_year + 1900 - BLS_API_YEARS) {
+      memset(v, 0, sizeof(struct BLSValidator));
+      if (bls_full(easy, &files[i], v, callback, user) == BLS_OK && cache) {
+        cache->save(user, files[i].url, v);
+      }
+      continue;
+    }
+    if (bls_request(easy, files[i].url, v, NULL, NULL) != BLS_OK) {
+      continue; /* Not modified, or try again next time */
+    }
+    changed[i] = true;
+    since = held < since ? held : since;
+    for (size_t k = 0; k < files[i].count; k++) {
+      if (m == BLS_API_SERIES_MAX) {
+        status = bls_api(easy, series, m, since, callback, user) == BLS_OK ? status : BLS_ERROR;
+        m = 0;
+      }
+      series[m++] = files[i].series[k];
+    }
+  }
+  if (m) {
+    status = bls_api(easy, series, m, since, callback, user) == BLS_OK ? status : BLS_ERROR;
+  }
+  for (size_t i = 0; status == BLS_OK && changed && i < n; i++) {
+    if (changed[i]) {
+      cache->save(user, files[i].url, &validators[i]);
+    }
+  }
+
+  free(changed);
+  free(validators);
+  curl_easy_cleanup(easy);
+}
+
+void bls_download(const struct BLSCache *cache, bls_data_handler callback, void *user)
+{
+  static const char * const cpi_u[] = { BLS_SERIES_ID_CPI_U };
+  static const char * const cpi_w[] = { BLS_SERIES_ID_CPI_W };
+  static const char * const ppi[]   = { BLS_SERIES_ID_PPI   };
+  static const struct BLSFile files[] = {
+    { BLS_LABSTAT_CPI_U, cpi_u, sizeof(cpi_u) / sizeof(cpi_u[0]) },
+    { BLS_LABSTAT_CPI_W, cpi_w, sizeof(cpi_w) / sizeof(cpi_w[0]) },
+    { BLS_LABSTAT_PPI  , ppi  , sizeof(ppi)   / sizeof(ppi[0])   },
+  };
+
+  bls_download_files(files, sizeof(files) / sizeof(files[0]), cache, callback, user);
 }
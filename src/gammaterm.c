@@ -1,5 +1,6 @@
 #include <ctype.h>
 #include <locale.h>
+#include <math.h>
 #include <pthread.h>
 #include <signal.h>
 #include <stdlib.h>
@@ -8,6 +9,7 @@
 #include "../include/config.h"
 #include "../include/gammaterm.h"
 #include "../include/hdb.h"
+#include "../include/http.h"
 #include "../include/layout.h"
 #include "../include/log.h"
 #include "../include/plt.h"
@@ -245,6 +247,7 @@ static void wprint_help(WINDOW *win)
   mvwaddstrcp(win, y++, x, cp, ".LINK <GO>               Open link");
 
   y++;
+  mvwaddstrcp(win, y++, x, cp, ":{BF <GO>}                              Backfill histories");
   mvwaddstrcp(win, y++, x, cp, ":{CP [SYMBOL]+ <GO>}                    Compare prices");
   mvwaddstrcp(win, y++, x, cp, ":{CPPI <GO>}                            Consumer/Producer Price Index");
   mvwaddstrcp(win, y++, x, cp, ":{HP [DATE_RANGE [DATE_RANGE]] <GO>}    Historical prices");
@@ -660,6 +663,106 @@ static void wprint_headline(WINDOW *win, const struct YHeadline * const p)
   }
 }
 
+#define FINANCIALS_QUARTERS 4
+#define FINANCIALS_YEARS    3
+#define FINANCIALS_LABEL    24
+#define FINANCIALS_WIDTH    12
+
+/* Amounts scaled to a magnitude suffix, colored by sign; periods not reported are blank */
+static void wprintf_amount(WINDOW *win, int w, double v)
+{
+  static const char suffixes[] = " KMBT";
+  if (isnan(v)) {
+    wprintw(win, "%*s", w, "--");
+    return;
+  }
+  int i = 0;
+  double u = v;
+  for ( ; fabs(u) >= 1000 && i < 4; u /= 1000, i++);
+  wprintwcp(win, COLOR_PAIR_CHANGE(v), "%*.2f%c", w - 1, u, suffixes[i]);
+}
+
+static int mvwprintf_periods(WINDOW *win, int y, int x, const struct YFundamentals * const F,
+                             enum YFrequency f, long r, int n)
+{
+  for (int p = F->counts[f][r] - n; p < F->counts[f][r]; p++, x += FINANCIALS_WIDTH) {
+    mvwprintwcp(win, y, x, COLOR_PAIR_KEY, "%*s", FINANCIALS_WIDTH, YFundamentals_date(F, f, r, p));
+  }
+  return x;
+}
+
+static int mvwprintf_values(WINDOW *win, int y, int x, const struct YFundamentals * const F,
+                            enum YFrequency f, enum YFundamental t, long r, int n)
+{
+  wmove(win, y, x);
+  for (int p = F->counts[f][r] - n; p < F->counts[f][r]; p++, x += FINANCIALS_WIDTH) {
+    wprintf_amount(win, FINANCIALS_WIDTH, YFundamentals_value(F, f, t, r, p));
+  }
+  return x;
+}
+
+/**
+ * The latest quarters and years of every fundamental of the symbol, then
+ * the latest annual figures of each watchlist symbol held, as a screen.
+ */
+static void wprint_financials(WINDOW *win, const char *symbol, const GPtrArray * const p)
+{
+  static const enum YFundamental screen[] = {
+    YFUNDAMENTAL_TotalRevenue, YFUNDAMENTAL_NetIncome, YFUNDAMENTAL_FreeCashFlow, YFUNDAMENTAL_DilutedEPS,
+  };
+
+  getallyx(win);
+  box(win, 0, 0);
+
+  int y = MARGIN_Y, x = MARGIN_X, w = maxx - x * 2;
+  mvwaddstrcp(win, y++, x, COLOR_PAIR_TITLE, "Financials");
+  const struct YFundamentals * const F = yql_fundamentals_get();
+  long r = yql_fundamentals_row(symbol);
+  if (r < 0) {
+    mvwaddstrcn(win, ++y, x, w, COLOR_PAIR_INFO, "No data found.");
+    return;
+  }
+
+  int nq = min(F->counts[YFREQUENCY_QUARTERLY][r], FINANCIALS_QUARTERS);
+  int na = min(F->counts[YFREQUENCY_ANNUAL][r], FINANCIALS_YEARS);
+  ++y, x += MARGIN_X;
+  mvwprintwcp(win, y, x, COLOR_PAIR_INFO, "As of %s", F->asOfDates[r]);
+  int xa = mvwprintf_periods(win, y, x + FINANCIALS_LABEL, F, YFREQUENCY_QUARTERLY, r, nq) + MARGIN_X;
+  mvwprintf_periods(win, y++, xa, F, YFREQUENCY_ANNUAL, r, na);
+  mvwhline(win, y++, x, ACS_HLINE, maxx - x * 2);
+  for (int t = 0; t < YFUNDAMENTALS && y < maxy - MARGIN_Y - 1; t++, y++) {
+    mvwaddstrcp(win, y, x, COLOR_PAIR_KEY, yql_fundamental_name(t));
+    mvwprintf_values(win, y, x + FINANCIALS_LABEL, F, YFREQUENCY_QUARTERLY, t, r, nq);
+    mvwprintf_values(win, y, xa, F, YFREQUENCY_ANNUAL, t, r, na);
+  }
+
+  if (!p || !p->len || y + 4 >= maxy - MARGIN_Y) {
+    return;
+  }
+  y++;
+  mvwaddstrcp(win, y, x, COLOR_PAIR_KEY, "Symbol");
+  mvwaddstrcp(win, y, x + FINANCIALS_LABEL / 2, COLOR_PAIR_KEY, "As of");
+  for (size_t i = 0; i < sizeof(screen) / sizeof(screen[0]); i++) {
+    mvwprintwcp(win, y, x + FINANCIALS_LABEL + i * FINANCIALS_WIDTH * 2, COLOR_PAIR_KEY, "%*s",
+                FINANCIALS_WIDTH * 2, yql_fundamental_name(screen[i]));
+  }
+  mvwhline(win, ++y, x, ACS_HLINE, maxx - x * 2);
+  for (guint i = 0; i < p->len && ++y < maxy - MARGIN_Y - 1; ) {
+    for ( ; i < p->len && (r = yql_fundamentals_row(g_ptr_array_index(p, i))) < 0; i++);
+    if (i == p->len) {
+      break;
+    }
+    int n = F->counts[YFREQUENCY_ANNUAL][r], cpRow = i % 2 ? COLOR_PAIR_YELLOW : COLOR_PAIR_BLUE;
+    mvwaddstrcp(win, y, x, cpRow, F->symbols[r]);
+    mvwaddstrcp(win, y, x + FINANCIALS_LABEL / 2, cpRow, F->asOfDates[r]);
+    for (size_t k = 0; n && k < sizeof(screen) / sizeof(screen[0]); k++) {
+      wmove(win, y, x + FINANCIALS_LABEL + k * FINANCIALS_WIDTH * 2);
+      wprintf_amount(win, FINANCIALS_WIDTH * 2, YFundamentals_value(F, YFREQUENCY_ANNUAL, screen[k], r, n - 1));
+    }
+    i++;
+  }
+}
+
 struct Event *Event_new(enum EventType e_evt, int64_t ts, const char *symbol, const char *shortName)
 {
   struct Event *e = malloc(sizeof(struct Event));
@@ -780,7 +883,6 @@ struct Spark *Spark_new(enum PanelType e, PANEL *pan)
 void Spark_init(struct Spark *s)
 {
   s->cursym = g_string_sized_new(YSTRING_LENGTH);
-  s->query = g_string_sized_new(YSTRING_LENGTH);
   s->startDate = DATE_RANGE_3M;
   s->endDate = DATE_RANGE_0D;
   s->events = "history";
@@ -805,9 +907,6 @@ void Spark_init(struct Spark *s)
 #define DEFAULT_EQUITY "GME"
     s->symbols = config.g_equity;
     g_string_assign(s->cursym, s->symbols->len ? g_ptr_array_index(s->symbols, 0) : DEFAULT_EQUITY);
-    for (guint i = 0; i < s->symbols->len; i++) {
-      g_string_append_printf(s->query, "%s,", (char *) g_ptr_array_index(s->symbols, i));
-    }
 
     s->w_quote         = derwin(p_win, maxy / 2, maxx / 2, 0 * maxy / 2, 0 * maxx / 2);
     s->w_options       = derwin(p_win, maxy / 2, maxx / 2, 1 * maxy / 2, 0 * maxx / 2);
@@ -830,10 +929,6 @@ void Spark_init(struct Spark *s)
     s->symbols = config.g_crncy;
     g_string_assign(s->cursym, s->symbols->len ? g_ptr_array_index(s->symbols, 0) : DEFAULT_CRNCY);
   SPARK_INIT:
-    for (guint i = 0; i < s->symbols->len; i++) {
-      g_string_append_printf(s->query, "%s,", (char *) g_ptr_array_index(s->symbols, i));
-    }
-
     s->w_quote = derwin(p_win, maxy / 2, maxx / 2, 0 * maxy / 2, 0 * maxx / 2);
     s->w_chart = derwin(p_win, maxy / 2, maxx / 2, 0 * maxy / 2, 1 * maxx / 2);
     s->w_spark = derwin(p_win, maxy / 2, maxx    , 1 * maxy / 2, 0           );
@@ -853,7 +948,6 @@ void Spark_init(struct Spark *s)
 void Spark_free(struct Spark *s)
 {
   g_string_free(s->cursym, TRUE);
-  g_string_free(s->query, TRUE);
 
   switch (s->e_pan) {
   case HELP:
@@ -916,6 +1010,104 @@ static int query(int (*f)(const char *), const char *x)
   return query_e(f(x), x);
 }
 
+/**
+ * quoteSummary sections each PanelMode renders, and those each quote type
+ * has at all; a refresh requests the intersection for the current symbol.
+ * financialData carries the target price drawn by Spark_plot().
+ */
+static const unsigned mode_modules[] = {
+  [MODE_DEFAULT]    = YMODULE_ASSET_PROFILE | YMODULE_DEFAULT_KEY_STATISTICS | YMODULE_FINANCIAL_DATA | YMODULE_TOP_HOLDINGS,
+  [MODE_PROFILE]    = 0,
+  [MODE_FINANCIALS] = 0,
+  [MODE_CHART]      = YMODULE_FINANCIAL_DATA,
+  [MODE_OPTIONS]    = 0,
+  [MODE_WATCHLIST]  = 0,
+  [MODE_EVENTS]     = YMODULE_EARNINGS_HISTORY | YMODULE_EARNINGS_TREND,
+  [MODE_NEWS]       = 0,
+};
+
+static unsigned query_modules(enum PanelMode e, const struct YQuote * const q)
+{
+  unsigned modules = mode_modules[e];
+  if (IS_EQUITY(q->quoteType)) {
+    return modules & ~YMODULE_TOP_HOLDINGS;
+  } else if (IS_ETF(q->quoteType) || IS_MUTUALFUND(q->quoteType)) {
+    return modules & (YMODULE_DEFAULT_KEY_STATISTICS | YMODULE_TOP_HOLDINGS);
+  } else {
+    return 0;
+  }
+}
+
+static int query_batch(const char **x, size_t n, const char *fields)
+{
+  return n ? query_e(yql_quote_batch(x, n, fields), x[0]) : 0;
+}
+
+static int query_spark(const char **x, size_t n)
+{
+  return n ? query_e(yql_spark(x, n), x[0]) : 0;
+}
+
+static int query_symbols(const GPtrArray * const p)
+{
+  return p ? query_batch((const char **) p->pdata, p->len, SPARK_FIELDS) : 0;
+}
+
+/* Runs task(arg) on a detached thread; returns non-zero if it did not start */
+static int start_task(void *(*task)(void *), void *arg)
+{
+  pthread_t thread;
+  int errnum = 0;
+
+  if ((errnum = pthread_create(&thread, NULL, task, arg)) != 0) {
+    log_default("pthread_create(): %s\n", strerror(errnum));
+    return errnum;
+  }
+  if ((errnum = pthread_detach(thread)) != 0) {
+    log_default("pthread_detach(): %s\n", strerror(errnum));
+  }
+  return 0;
+}
+
+/**
+ * Fundamentals of the symbol and of the watchlist equities, for the screen;
+ * what changed is saved off the UI thread.
+ */
+static int query_fundamentals(const struct Spark * const s)
+{
+  GPtrArray *x = g_ptr_array_new();
+  const struct YQuote *q = yql_quote_get(s->cursym->str);
+  if (q && IS_EQUITY(q->quoteType)) {
+    g_ptr_array_add(x, s->cursym->str);
+  }
+  for (guint i = 0; s->symbols && i < s->symbols->len; i++) {
+    q = yql_quote_get(g_ptr_array_index(s->symbols, i));
+    if (q && IS_EQUITY(q->quoteType)) {
+      g_ptr_array_add(x, g_ptr_array_index(s->symbols, i));
+    }
+  }
+  int status = x->len ? query_e(yql_timeseries((const char **) x->pdata, x->len), s->cursym->str) : 0;
+  void *save = x->len ? hdb_collect_fundamentals(&hdb, (const char **) x->pdata, x->len) : NULL;
+  if (save && start_task(hdb_save_fundamentals, save) != 0) {
+    hdb_save_fundamentals(save);
+  }
+  g_ptr_array_free(x, TRUE);
+  return status;
+}
+
+/* Streams the symbol and its watchlist, in place of the previous panel's */
+static int stream_symbols(const struct Spark * const s)
+{
+  GPtrArray *x = g_ptr_array_new();
+  g_ptr_array_add(x, s->cursym->str);
+  for (guint i = 0; s->symbols && i < s->symbols->len; i++) {
+    g_ptr_array_add(x, g_ptr_array_index(s->symbols, i));
+  }
+  int status = yql_stream_subscribe((const char **) x->pdata, x->len);
+  g_ptr_array_free(x, TRUE);
+  return status;
+}
+
 void Spark_update(struct Spark *s)
 {
   switch (s->e_pan) {
@@ -930,54 +1122,62 @@ void Spark_update(struct Spark *s)
   case EQUITY:
     query(yql_quote, s->cursym->str);
     const struct YQuote * const q = yql_quote_get(s->cursym->str);
+    yql_multi_begin();
     if (IS_OPTION(q->quoteType)) {
       query(yql_quote, q->underlyingSymbol);
     }
-    if (IS_EQUITY(q->quoteType)) {
-      query(yql_quoteSummary, s->cursym->str);
-      query(yql_earnings, s->cursym->str);
+    query_e(yql_quoteSummary(s->cursym->str, query_modules(s->e_mod, q)), s->cursym->str);
+    query(yql_chart_update, s->cursym->str);
+    if (IS_EQUITY(q->quoteType) || IS_ETF(q->quoteType)) {
+      if (s->expiryDate) {
+        query_e(yql_options_series(s->cursym->str, s->expiryDate), s->cursym->str);
+      } else {
+        query(yql_options, s->cursym->str);
+      }
+    }
+    query(yql_headline, s->cursym->str);
+    query_symbols(s->symbols);
+    yql_multi_end(query_e);
+    stream_symbols(s);
+    if (s->e_mod == MODE_FINANCIALS) {
+      query_fundamentals(s);
     }
     if (IS_ETF(q->quoteType) || IS_MUTUALFUND(q->quoteType)) {
-      if (query(yql_holdings, s->cursym->str) == YERROR_NERR) {
-        const struct YQuoteSummary * const qs = yql_quoteSummary_get(s->cursym->str);
-        const struct Holding * const h = qs->topHoldings.holdings;
-        char str[HOLDINGS * YSTRING_LENGTH + 1] = { 0 };
+      const struct YQuoteSummary * const qs = yql_quoteSummary_get(s->cursym->str);
+      if (qs) {
+        const char *h[HOLDINGS];
         for (int i = 0; i < HOLDINGS; i++) {
-          YString_append(str, h[i].symbol);
-          strcat(str, ",");
+          h[i] = qs->topHoldings.holdings[i].symbol;
         }
-        query(yql_quote, str);
+        query_batch(h, HOLDINGS, NULL);
       }
     }
-    query(yql_chart, s->cursym->str);
     if (IS_EQUITY(q->quoteType) || IS_ETF(q->quoteType)) {
-      if (s->expiryDate) {
-        query_e(yql_options_series(s->cursym->str, s->expiryDate), s->cursym->str);
-      } else if (query(yql_options, s->cursym->str) == YERROR_NERR) {
-        const struct YOptionChain * const o = yql_optionChain_get(s->cursym->str);
+      const struct YOptionChain * const o = yql_optionChain_get(s->cursym->str);
+      if (!s->expiryDate && o && o->count) {
         s->expiryDate = o->expirationDates[0];
         s->strikePrice = o->strikes[o->count / 2];
       }
     }
-    query(yql_headline, s->cursym->str);
-    if (s->query->len) {
-      query(yql_quote, s->query->str);
-    }
     break;
   case CMDTY:
   case INDEX:
   case CRNCY:
+    yql_multi_begin();
     query(yql_quote, s->cursym->str);
-    query(yql_chart, s->cursym->str);
+    query(yql_chart_update, s->cursym->str);
     query(yql_headline, s->cursym->str);
-    if (s->query->len) {
-      query(yql_quote, s->query->str);
-    }
+    query_symbols(s->symbols);
+    yql_multi_end(query_e);
+    stream_symbols(s);
     break;
   case CLIENT:
     struct Portfolio *p = getcurrpor();
     if (p) {
-      query(yql_quote, p->query->str);
+      gchar **symbols = g_strsplit(p->query->str, ",", -1);
+      query_batch((const char **) symbols, g_strv_length(symbols), NULL);
+      yql_stream_subscribe((const char **) symbols, g_strv_length(symbols));
+      g_strfreev(symbols);
       Portfolio_updates(p);
     }
     break;
@@ -1058,6 +1258,9 @@ void Spark_mpaint(struct Spark *s)
     /* case MODE_DEFAULT: */
     /*   Spark_paint(s); */
     /*   break; */
+  case MODE_FINANCIALS:
+    wprint_financials(s->w_details, s->cursym->str, s->symbols);
+    break;
   case MODE_CHART:
     wprint_chart(s->w_details, yql_chart_get(s->cursym->str));
     break;
@@ -1125,6 +1328,117 @@ void Spark_download(struct Spark *s)
   fclose(file);
 }
 
+/**
+ * Backfill: the full daily history of every configured symbol and portfolio
+ * holding, saved as DOWNLOAD_FILENAME files and into hdb.  It runs off the
+ * UI thread, where BF reports its progress, or headless as
+ * "gammaterm backfill" for a nightly job.
+ */
+#define BACKFILL_PARALLEL 16
+
+static struct
+{
+  pthread_mutex_t lock;
+  bool    running;
+  bool    verbose; /*< progress on stderr */
+  size_t  total;
+  size_t  landed;
+  size_t  failed;
+  int64_t period2;
+} backfill = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static FILE *backfill_open(void *u _U_, const char *symbol)
+{
+  return mkfile(DOWNLOAD_FILENAME, symbol, "history", 0L, backfill.period2);
+}
+
+static int backfill_done(int status, const char *symbol)
+{
+  pthread_mutex_lock(&backfill.lock);
+  backfill.landed++;
+  if (status != YERROR_NERR) {
+    backfill.failed++;
+    log_default("backfill(%s): %d\n", symbol, status);
+  }
+  if (backfill.verbose) {
+    fprintf(stderr, "\rbackfill: %zu/%zu, %zu failed", backfill.landed, backfill.total, backfill.failed);
+  }
+  pthread_mutex_unlock(&backfill.lock);
+  return status;
+}
+
+static void backfill_add(GPtrArray *symbols, GHashTable *seen, const char *s)
+{
+  gchar *p = g_strstrip(g_strdup(s));
+  if (*p && g_hash_table_add(seen, p)) {
+    g_ptr_array_add(symbols, p);
+  } else {
+    g_free(p);
+  }
+}
+
+static GPtrArray *backfill_symbols()
+{
+  GPtrArray *symbols = g_ptr_array_new_with_free_func(g_free);
+  GHashTable *seen = g_hash_table_new(g_str_hash, g_str_equal);
+
+  GPtrArray * const lists[] = { config.g_equity, config.g_cmdty, config.g_index, config.g_crncy };
+  for (size_t i = 0; i < sizeof(lists) / sizeof(lists[0]); i++) {
+    for (guint j = 0; lists[i] && j < lists[i]->len; j++) {
+      backfill_add(symbols, seen, g_ptr_array_index(lists[i], j));
+    }
+  }
+  for (guint i = 0; portfolios && i < portfolios->len; i++) {
+    const struct Portfolio * const p = g_ptr_array_index(portfolios, i);
+    gchar **v = g_strsplit(p->query->str, ",", -1);
+    for (gchar **q = v; *q; q++) {
+      backfill_add(symbols, seen, *q);
+    }
+    g_strfreev(v);
+  }
+
+  g_hash_table_destroy(seen);
+  return symbols;
+}
+
+/* Returns the symbols to backfill, or NULL if a backfill is running */
+static GPtrArray *backfill_begin(bool verbose)
+{
+  pthread_mutex_lock(&backfill.lock);
+  if (backfill.running) {
+    pthread_mutex_unlock(&backfill.lock);
+    return NULL;
+  }
+  GPtrArray *symbols = backfill_symbols();
+  backfill.running = true, backfill.verbose = verbose;
+  backfill.total = symbols->len, backfill.landed = 0, backfill.failed = 0;
+  backfill.period2 = time(NULL);
+  pthread_mutex_unlock(&backfill.lock);
+  return symbols;
+}
+
+static void *backfill_task(void *arg)
+{
+  GPtrArray *symbols = arg;
+  struct YDownload d = {
+    .period1  = 0,
+    .period2  = backfill.period2,
+    .interval = "1d",
+    .parallel = BACKFILL_PARALLEL,
+    .open     = backfill_open,
+    .done     = backfill_done,
+  };
+  hdb_download_histories(&hdb, (const char **) symbols->pdata, symbols->len, &d);
+
+  pthread_mutex_lock(&backfill.lock);
+  log_default("backfill: %zu/%zu, %zu failed\n", backfill.landed, backfill.total, backfill.failed);
+  backfill.running = false;
+  pthread_mutex_unlock(&backfill.lock);
+
+  g_ptr_array_free(symbols, TRUE);
+  return NULL;
+}
+
 static void plot_basket(const struct YChart * const c)
 {
   const struct YQuoteSummary * const qs = yql_quoteSummary_get(c->symbol);
@@ -1132,12 +1446,18 @@ static void plot_basket(const struct YChart * const c)
     return;
   }
 
+  const char *h[HOLDINGS];
+  for (int i = 0; i < HOLDINGS; i++) {
+    h[i] = qs->topHoldings.holdings[i].symbol;
+  }
+  query_spark(h, HOLDINGS);
+
   const struct YChart *C[HOLDINGS + 1] = { c, };
   size_t n = 1;
   for (int i = 0; i < HOLDINGS; i++) {
-    const char *symbol = qs->topHoldings.holdings[i].symbol;
-    if (YString_length(symbol) && query(yql_chart, symbol) == YERROR_NERR) {
-      C[n++] = yql_chart_get(symbol);
+    const struct YChart * const d = YString_length(h[i]) ? yql_chart_get(h[i]) : NULL;
+    if (d && d->count) {
+      C[n++] = d;
     }
   }
 
@@ -1456,14 +1776,34 @@ static void runcmd(char *cmd)
   if (tok) {
     time_t tm = 0;
     if (streq(tok, "CP")) {
+      const char *symbols[HOLDINGS];
+      size_t m = 0;
+      while (m < HOLDINGS && (tok = strtok(NULL, " "))) {
+        symbols[m++] = tok;
+      }
+      query_spark(symbols, m);
+
       const struct YChart *C[HOLDINGS + 1] = { yql_chart_get(s->cursym->str), };
       size_t n = 1;
-      while (n < HOLDINGS + 1 && (tok = strtok(NULL, " "))) {
-        if (query(yql_chart, tok) == YERROR_NERR) {
-          C[n++] = yql_chart_get(tok);
+      for (size_t i = 0; i < m; i++) {
+        const struct YChart * const d = yql_chart_get(symbols[i]);
+        if (d && d->count) {
+          C[n++] = d;
         }
       }
       Spark_rplot(s, C, n);
+    } else if (streq(tok, "BF")) {
+      GPtrArray *symbols = backfill_begin(false);
+      if (symbols) {
+        start_task(backfill_task, symbols);
+        wprint_pop(w_pop, "backfill", "Notification", "Backfill started", "");
+        return;
+      }
+      pthread_mutex_lock(&backfill.lock);
+      char *desc = _asprintf("%zu/%zu done, %zu failed", backfill.landed, backfill.total, backfill.failed);
+      pthread_mutex_unlock(&backfill.lock);
+      wprint_pop(w_pop, "backfill", "Notification", desc, "");
+      free(desc);
     } else if (streq(tok, "CPPI")) {
       plot_series();
     } else if (streq(tok, "HP")) {
@@ -1608,21 +1948,6 @@ static void paint(enum PanelType newpan)
   doupdate();
 }
 
-static void start_task(void *(*task)(void *), void *arg)
-{
-  pthread_t thread;
-  int errnum = 0;
-
-  if ((errnum = pthread_create(&thread, NULL, task, arg)) != 0) {
-    log_default("pthread_create(): %s\n", strerror(errnum));
-    return;
-  }
-  if ((errnum = pthread_detach(thread)) != 0) {
-    log_default("pthread_detach(): %s\n", strerror(errnum));
-    return;
-  }
-}
-
 static void start()
 {
   EventCalendar_init(&calendar, gtm_bow, gtm_bow + gtm_diffday * EVENT_QUARTERLY);
@@ -1633,8 +1958,11 @@ static void start()
   plot = plt_gpopen();
   portfolios = Portfolios_new(config.g_pfs);
 
+  http_init();
   yql_init();
   yql_open();
+  yql_stream_open(NULL);
+  hdb_select_fundamentals(&hdb);
   start_task(hdb_download_series, &hdb);
 
   wprint_top(w_top);
@@ -1748,6 +2076,11 @@ static void start()
       Spark_mrefresh(getcurrspr(), MODE_EVENTS);
       paint(curpan);
       break;
+    case 'F':
+    case 'f':
+      Spark_mrefresh(getcurrspr(), MODE_FINANCIALS);
+      paint(curpan);
+      break;
     case 'N':
     case 'n':
       Spark_mrefresh(getcurrspr(), MODE_NEWS);
@@ -1762,6 +2095,10 @@ static void start()
     case 'q':
       return;
     case ERR:
+      if (yql_poll(NULL) > 0) {
+        Spark_mpaint(getcurrspr());
+        update_panels();
+      }
       start_clock(w_top);
       doupdate();
       break;
@@ -1771,8 +2108,10 @@ static void start()
 
 static void destroy()
 {
+  yql_stream_close();
   yql_close();
   yql_free();
+  http_free();
 
   g_ptr_array_free(portfolios, TRUE); portfolios = NULL;
   plt_gpclose(plot);                  plot = NULL;
@@ -1809,10 +2148,39 @@ static void sighandler(int sig)
   }
 }
 
+/* gammaterm backfill [OPTION]...: BF without the terminal */
+static int backfill_main(int argc, char *argv[])
+{
+  iextp_config_open(&config, argc, argv);
+
+  hdb_init(&hdb, HDB_FILENAME);
+  hdb_open(&hdb);
+  portfolios = Portfolios_new(config.g_pfs);
+
+  http_init();
+  yql_init();
+
+  backfill_task(backfill_begin(true));
+  fprintf(stderr, "\n");
+  int status = backfill.failed ? EXIT_FAILURE : EXIT_SUCCESS;
+
+  yql_free();
+  http_free();
+  g_ptr_array_free(portfolios, TRUE); portfolios = NULL;
+  hdb_close(&hdb);
+  iextp_config_free(&config);
+
+  return status;
+}
+
 int main(int argc, char *argv[])
 {
   setlocale(LC_ALL, "");
 
+  if (argc > 1 && streq(argv[1], "backfill")) {
+    return backfill_main(argc - 1, argv + 1);
+  }
+
   if (signal(SIGINT, sighandler) == SIG_ERR) {
     perror("signal(SIGINT)");
   }
@@ -1,3 +1,6 @@
+#include <errno.h>
+#include <math.h>
+
 #include "../include/hdb.h"
 #include "../include/log.h"
 #include "../include/util.h"
@@ -9,6 +12,7 @@ int hdb_init(struct hdb_t *hdb, char *dbpath)
   hdb->dbpath = dbpath;
   hdb->db = NULL;
   hdb->upsert_history = NULL;
+  hdb->upsert_fundamental = NULL;
   hdb->upsert_series = NULL;
   hdb->errmsg = NULL;
   return HDB_OK;
@@ -39,9 +43,15 @@ static int hdb_create(struct hdb_t *hdb)
   if ((status = exec_stmt(hdb, CREATE_HISTORY)) != HDB_OK) {
     return status;
   }
+  if ((status = exec_stmt(hdb, CREATE_FUNDAMENTAL)) != HDB_OK) {
+    return status;
+  }
   if ((status = exec_stmt(hdb, CREATE_SERIES)) != HDB_OK) {
     return status;
   }
+  if ((status = exec_stmt(hdb, CREATE_VALIDATOR)) != HDB_OK) {
+    return status;
+  }
   return status;
 }
 
@@ -52,6 +62,9 @@ int hdb_open(struct hdb_t *hdb)
     hdb_close(hdb);
     return HDB_ERROR;
   }
+  /* Background tasks write through their own connections, see hdb_fork() */
+  sqlite3_busy_timeout(hdb->db, HDB_BUSY_TIMEOUT);
+  exec_stmt(hdb, "PRAGMA journal_mode=WAL");
   if (hdb_create(hdb) != HDB_OK) {
     hdb_close(hdb);
     return HDB_ERROR;
@@ -61,6 +74,11 @@ int hdb_open(struct hdb_t *hdb)
     hdb_close(hdb);
     return HDB_ERROR;
   }
+  if (sqlite3_prepare_v3(hdb->db, UPSERT_FUNDAMENTAL, -1, SQLITE_PREPARE_PERSISTENT, &hdb->upsert_fundamental, NULL) != SQLITE_OK) {
+    log_default("sqlite3_prepare_v3(UPSERT_FUNDAMENTAL): %s\n", sqlite3_errmsg(hdb->db));
+    hdb_close(hdb);
+    return HDB_ERROR;
+  }
   if (sqlite3_prepare_v3(hdb->db, UPSERT_SERIES, -1, SQLITE_PREPARE_PERSISTENT, &hdb->upsert_series, NULL) != SQLITE_OK) {
     log_default("sqlite3_prepare_v3(UPSERT_SERIES): %s\n", sqlite3_errmsg(hdb->db));
     hdb_close(hdb);
@@ -75,6 +93,10 @@ void hdb_close(struct hdb_t *hdb)
     log_default("sqlite3_finalize(UPSERT_HISTORY): %s\n", sqlite3_errmsg(hdb->db));
   }
   hdb->upsert_history = NULL;
+  if (sqlite3_finalize(hdb->upsert_fundamental) != SQLITE_OK) {
+    log_default("sqlite3_finalize(UPSERT_FUNDAMENTAL): %s\n", sqlite3_errmsg(hdb->db));
+  }
+  hdb->upsert_fundamental = NULL;
   if (sqlite3_finalize(hdb->upsert_series) != SQLITE_OK) {
     log_default("sqlite3_finalize(UPSERT_SERIES): %s\n", sqlite3_errmsg(hdb->db));
   }
@@ -140,6 +162,174 @@ void hdb_upsert_histories(struct hdb_t *hdb, const YArray * const A)
   hdb_commit(hdb);
 }
 
+/**
+ * Opens a connection of its own to the database of hdb, for a task off the
+ * UI thread: transactions are per connection, so sharing hdb would let one
+ * thread's COMMIT end another's transaction.
+ */
+static int hdb_fork(const struct hdb_t *hdb, struct hdb_t *task)
+{
+  hdb_init(task, hdb->dbpath);
+  return hdb->db ? hdb_open(task) : HDB_ERROR;
+}
+
+/**
+ * Bulk downloads the histories of symbols as described by d, upserting the
+ * rows parsed whenever a symbol is done or HDB_BATCH_ROWS are held, each
+ * time in a transaction of its own: none stays open while the download
+ * waits on the network, locking other connections out.  Without a database
+ * only d's own sinks are fed.
+ */
+int hdb_download_histories(struct hdb_t *hdb, const char **symbols, size_t n, struct YDownload *d)
+{
+  struct hdb_t task;
+  YArray rows = { .data = NULL, .length = 0, .capacity = HDB_BATCH_ROWS };
+  YArray *A = &rows;
+  int (*done)(int, const char *) = d->done;
+  void flush()
+  {
+    if (A->length) {
+      hdb_upsert_histories(&task, A);
+      A->length = 0;
+    }
+  }
+  void c(void *u _U_, const struct YHistory *h)
+  {
+    *YArray_index(A, struct YHistory, A->length++) = *h; /* h->symbol lives until the symbol is done */
+    if (A->length == A->capacity) {
+      flush();
+    }
+  }
+  int e(int status, const char *s)
+  {
+    flush();
+    return done ? done(status, s) : status;
+  }
+
+  if (hdb_fork(hdb, &task) != HDB_OK) {
+    return yql_download_m(symbols, n, d);
+  }
+  A->data = reallocarray(NULL, A->capacity, sizeof(struct YHistory));
+  if (!A->data) {
+    log_default("%s:%d: reallocarray(%zu): %s\n", __FILE__, __LINE__, A->capacity, strerror(errno));
+    hdb_close(&task);
+    return yql_download_m(symbols, n, d);
+  }
+
+  d->row = c, d->done = e, d->user = &task;
+  int status = yql_download_m(symbols, n, d);
+  flush();
+  d->done = done;
+  free(A->data);
+  hdb_close(&task);
+  return status;
+}
+
+/* A period of a fundamental, copied out of the yql store */
+struct hdb_fundamental
+{
+  YString     symbol;
+  int         frequency;
+  const char *type;
+  YDate       date;
+  double      value;
+};
+
+struct hdb_fundamentals
+{
+  const struct hdb_t *hdb;
+  GArray             *values;
+};
+
+/**
+ * Copies every period held of those symbols changed since last saved and
+ * marks them saved, for hdb_save_fundamentals() to write off the UI thread,
+ * which alone touches the yql store.  Returns NULL if nothing changed.
+ */
+void *hdb_collect_fundamentals(const struct hdb_t *hdb, const char **symbols, size_t n)
+{
+  if (!hdb->db) {
+    return NULL;
+  }
+
+  const struct YFundamentals * const F = yql_fundamentals_get();
+  GArray *values = g_array_new(FALSE, FALSE, sizeof(struct hdb_fundamental));
+  for (size_t i = 0; i < n; i++) {
+    long r = yql_fundamentals_row(symbols[i]);
+    if (r < 0 || !F->changed[r]) {
+      continue;
+    }
+    for (int f = 0; f < YFREQUENCIES; f++) {
+      for (int t = 0; t < YFUNDAMENTALS; t++) {
+        for (size_t p = 0; p < F->counts[f][r]; p++) {
+          struct hdb_fundamental v = { .frequency = f, .type = yql_fundamental_name(t) };
+          v.value = YFundamentals_value(F, f, t, r, p);
+          if (isnan(v.value)) {
+            continue;
+          }
+          YString_copy(v.symbol, F->symbols[r]);
+          memcpy(v.date, YFundamentals_date(F, f, r, p), sizeof(YDate));
+          g_array_append_val(values, v);
+        }
+      }
+    }
+    yql_fundamentals_saved(r);
+  }
+
+  struct hdb_fundamentals *x = values->len ? malloc(sizeof(struct hdb_fundamentals)) : NULL;
+  if (!x) {
+    g_array_free(values, TRUE);
+    return NULL;
+  }
+  x->hdb = hdb, x->values = values;
+  return x;
+}
+
+/* Task writing what hdb_collect_fundamentals() copied, through a connection of its own */
+void *hdb_save_fundamentals(void *arg)
+{
+  struct hdb_fundamentals *x = arg;
+  struct hdb_t task;
+
+  if (hdb_fork(x->hdb, &task) == HDB_OK) {
+    hdb_begin(&task);
+    for (guint i = 0; i < x->values->len; i++) {
+      const struct hdb_fundamental * const v = &g_array_index(x->values, struct hdb_fundamental, i);
+      int k = 1;
+      sqlite3_bind_text   (task.upsert_fundamental, k++, v->symbol, -1, SQLITE_STATIC);
+      sqlite3_bind_int    (task.upsert_fundamental, k++, v->frequency);
+      sqlite3_bind_text   (task.upsert_fundamental, k++, v->type, -1, SQLITE_STATIC);
+      sqlite3_bind_text   (task.upsert_fundamental, k++, v->date, -1, SQLITE_STATIC);
+      sqlite3_bind_double (task.upsert_fundamental, k++, v->value);
+      exec_pstmt(task.upsert_fundamental);
+    }
+    hdb_commit(&task);
+    hdb_close(&task);
+  }
+
+  g_array_free(x->values, TRUE);
+  free(x);
+  return NULL;
+}
+
+static int select_fundamental_callback(void *u _U_, int argc _U_, char **argv, char **argcn _U_)
+{
+  int f = atoi(argv[1]), t = yql_fundamental_type(argv[2]);
+  if (f >= 0 && f < YFREQUENCIES && t >= 0 && argv[3] && argv[4]) {
+    yql_fundamentals_put(argv[0], f, t, argv[3], atof(argv[4]));
+  }
+  return 0;
+}
+
+/* Loads the fundamentals saved into the yql store, which keeps the latest periods */
+void hdb_select_fundamentals(struct hdb_t *hdb)
+{
+  exec_query(hdb, SELECT_FUNDAMENTAL, select_fundamental_callback, NULL);
+  for (size_t r = 0; r < yql_fundamentals_get()->rows; r++) {
+    yql_fundamentals_saved(r);
+  }
+}
+
 void hdb_upsert_series(struct hdb_t *hdb, const struct BLSData * const d)
 {
   if (!hdb->db || !hdb->upsert_series) {
@@ -155,18 +345,96 @@ void hdb_upsert_series(struct hdb_t *hdb, const struct BLSData * const d)
   exec_pstmt(hdb->upsert_series);
 }
 
+static sqlite3_stmt *hdb_prepare(struct hdb_t *hdb, const char *sql, const char *text)
+{
+  sqlite3_stmt *stmt = NULL;
+  if (sqlite3_prepare_v2(hdb->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    log_default("sqlite3_prepare_v2(%s): %s\n", sql, sqlite3_errmsg(hdb->db));
+    return NULL;
+  }
+  sqlite3_bind_text(stmt, 1, text, -1, SQLITE_STATIC);
+  return stmt;
+}
+
+static void hdb_load_validator(void *u, const char *url, struct BLSValidator *v)
+{
+  sqlite3_stmt *stmt = hdb_prepare(u, SELECT_VALIDATOR, url);
+  if (stmt && sqlite3_step(stmt) == SQLITE_ROW) {
+    const unsigned char *etag = sqlite3_column_text(stmt, 0);
+    const unsigned char *modified = sqlite3_column_text(stmt, 1);
+    strncpy(v->etag, etag ? (const char *) etag : "", BLS_ETAG_LENGTH);
+    v->etag[BLS_ETAG_LENGTH] = '\0';
+    strncpy(v->modified, modified ? (const char *) modified : "", BLS_MODIFIED_LENGTH);
+    v->modified[BLS_MODIFIED_LENGTH] = '\0';
+  }
+  sqlite3_finalize(stmt);
+}
+
+static void hdb_save_validator(void *u, const char *url, const struct BLSValidator *v)
+{
+  sqlite3_stmt *stmt = hdb_prepare(u, UPSERT_VALIDATOR, url);
+  if (stmt) {
+    sqlite3_bind_text(stmt, 2, v->etag, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 3, v->modified, -1, SQLITE_STATIC);
+    sqlite3_step(stmt);
+  }
+  sqlite3_finalize(stmt);
+}
+
+static int hdb_series_since(void *u, const char *series)
+{
+  int year = 0;
+  sqlite3_stmt *stmt = hdb_prepare(u, SELECT_SERIES_SINCE, series);
+  if (stmt && sqlite3_step(stmt) == SQLITE_ROW) {
+    year = sqlite3_column_int(stmt, 0); /* 0 for NULL, no rows */
+  }
+  sqlite3_finalize(stmt);
+  return year;
+}
+
+/**
+ * Task refreshing the BLS series.  Data is upserted in a transaction of its
+ * own whenever HDB_BATCH_ROWS are held and before the validator of a file
+ * is saved, so none stays open across a transfer and a file is never
+ * marked current ahead of its data.
+ */
 void *hdb_download_series(void *arg)
 {
-  void c(void *u, const struct BLSData *d) { hdb_upsert_series(u, d); }
+  GArray *data = g_array_sized_new(FALSE, FALSE, sizeof(struct BLSData), HDB_BATCH_ROWS);
+  void flush(struct hdb_t *hdb)
+  {
+    if (data->len) {
+      hdb_begin(hdb);
+      for (guint i = 0; i < data->len; i++) {
+        hdb_upsert_series(hdb, &g_array_index(data, struct BLSData, i));
+      }
+      hdb_commit(hdb);
+      g_array_set_size(data, 0);
+    }
+  }
+  void c(void *u, const struct BLSData *d)
+  {
+    g_array_append_vals(data, d, 1);
+    if (data->len == HDB_BATCH_ROWS) {
+      flush(u);
+    }
+  }
+  void save(void *u, const char *url, const struct BLSValidator *v)
+  {
+    flush(u);
+    hdb_save_validator(u, url, v);
+  }
+  const struct BLSCache cache = { hdb_load_validator, save, hdb_series_since };
 
-  struct hdb_t *hdb = arg;
+  struct hdb_t task;
 
-  if (hdb->db) {
-    hdb_begin(hdb);
-    bls_download(c, hdb);
-    hdb_commit(hdb);
+  if (hdb_fork(arg, &task) == HDB_OK) {
+    bls_download(&cache, c, &task);
+    flush(&task);
+    hdb_close(&task);
   }
 
+  g_array_free(data, TRUE);
   return NULL;
 }
 
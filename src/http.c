@@ -0,0 +1,717 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "../include/http.h"
+#include "../include/log.h"
+#include "../include/util.h"
+
+/**
+ * Process-wide transport shared by yql and bls.  Every handle created here
+ * shares one DNS cache and one TLS session cache, so a second connection to
+ * a host skips the lookup and resumes the TLS session.  Connections
+ * themselves stay pooled by the long-lived handles of each module (curl
+ * does not support sharing a connection cache across concurrent threads).
+ */
+static CURLSH *share = NULL;
+static pthread_mutex_t locks[CURL_LOCK_DATA_LAST];
+
+/**
+ * Per-host admission state.  A token bucket paces requests; its rate grows
+ * additively on success and halves on 429, 5xx and transport errors.  After
+ * HTTP_BREAKER_FAILURES consecutive failures the circuit opens and requests
+ * are refused for HTTP_BREAKER_COOLDOWN, after which a single probe decides
+ * whether it closes again.
+ */
+struct HttpHost
+{
+  char    name[HTTP_HOST_LENGTH + 1];
+  double  rate;
+  double  tokens;
+  int64_t refill;
+  int     failures;
+  int64_t open_until;
+  double  latency; /*< EWMA of total transfer time, microseconds */
+  double  errors;  /*< EWMA of the failure rate */
+  int64_t used;    /*< time of the last report */
+};
+
+static struct HttpHost hosts[HTTP_MAX_HOSTS];
+static size_t nhosts = 0;
+static pthread_mutex_t host_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Record/replay.  Responses are stored one file per request, named by a
+ * hash of the URL without scheme and host (so query1 and query2 replay the
+ * same file), and listed in an index for inspection.  Replay serves them
+ * through file:// URLs, bypassing the limiter, with an optional latency
+ * before and bandwidth cap during each transfer.  curl can neither throttle
+ * nor pause file:// transfers, so under a cap the tee holds the body and
+ * http_drain() hands it on as each transfer's own budget allows.
+ */
+struct HttpTee
+{
+  CURL               *easy;
+  curl_write_callback write;
+  void               *data;
+  FILE               *file;
+  char                path[HTTP_PATH_LENGTH + 1];
+  struct HttpBuffer   held;  /*< body not yet drained, under a bandwidth cap */
+  size_t              sent;
+  int64_t             start; /*< monotonic microseconds, when the cap started */
+  struct HttpTee     *next;
+};
+
+static const char *record = NULL;
+static const char *replay = NULL;
+static const char *origin = NULL;
+static int64_t latency = 0;
+static curl_off_t bandwidth = 0;
+static struct HttpTee *tees = NULL;
+static pthread_mutex_t tee_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Idle response buffers.  A released buffer keeps its capacity, so once the
+ * pool holds a block as large as the usual response no further allocation
+ * happens for bodies of that size.
+ */
+static struct HttpBuffer pool[HTTP_BUFFER_POOL];
+static size_t npool = 0;
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void http_lock(CURL *handle _U_, curl_lock_data data, curl_lock_access access _U_, void *user _U_)
+{
+  pthread_mutex_lock(&locks[data]);
+}
+
+static void http_unlock(CURL *handle _U_, curl_lock_data data, void *user _U_)
+{
+  pthread_mutex_unlock(&locks[data]);
+}
+
+int http_init()
+{
+  if (share) {
+    return HTTP_OK;
+  }
+
+  CURLcode code = curl_global_init(CURL_GLOBAL_ALL);
+  if (code != CURLE_OK) {
+    log_default("curl_global_init(CURL_GLOBAL_ALL): %s\n", curl_easy_strerror(code));
+    return HTTP_ERROR;
+  }
+
+  share = curl_share_init();
+  if (!share) {
+    log_default("curl_share_init()\n");
+    curl_global_cleanup();
+    return HTTP_ERROR;
+  }
+  for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+    pthread_mutex_init(&locks[i], NULL);
+  }
+  curl_share_setopt(share, CURLSHOPT_LOCKFUNC, http_lock);
+  curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, http_unlock);
+  curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+  curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+
+  origin = getenv(HTTP_ORIGIN_ENV);
+  if (origin) {
+    log_default("http_init(): serving every request from %s\n", origin);
+  }
+  replay = getenv(HTTP_REPLAY_ENV);
+  record = replay ? NULL : getenv(HTTP_RECORD_ENV);
+  if (replay) {
+    const char *ms = getenv(HTTP_LATENCY_ENV), *bps = getenv(HTTP_BANDWIDTH_ENV);
+    latency = ms ? strtoll(ms, NULL, 10) * 1000 : 0;
+    bandwidth = bps ? strtoll(bps, NULL, 10) : 0;
+    log_default("http_init(): replaying from %s\n", replay);
+  } else if (record) {
+    if (mkdir(record, 0755) != 0 && errno != EEXIST) {
+      log_default("mkdir(%s): %s\n", record, strerror(errno));
+      record = NULL;
+    } else {
+      log_default("http_init(): recording to %s\n", record);
+    }
+  }
+
+  return HTTP_OK;
+}
+
+void http_free()
+{
+  pthread_mutex_lock(&pool_lock);
+  while (npool) {
+    free(pool[--npool].data);
+  }
+  pthread_mutex_unlock(&pool_lock);
+
+  if (share) {
+    curl_share_cleanup(share);              share = NULL;
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+      pthread_mutex_destroy(&locks[i]);
+    }
+    curl_global_cleanup();
+  }
+}
+
+CURL *http_easy_init()
+{
+  CURL *easy = curl_easy_init();
+  if (!easy) {
+    log_default("curl_easy_init()\n");
+    return NULL;
+  }
+
+  curl_easy_setopt(easy, CURLOPT_SHARE, share);
+  curl_easy_setopt(easy, CURLOPT_DNS_CACHE_TIMEOUT, HTTP_DNS_CACHE_TIMEOUT);
+  curl_easy_setopt(easy, CURLOPT_TCP_KEEPALIVE, 1L);
+  curl_easy_setopt(easy, CURLOPT_TCP_KEEPIDLE, HTTP_KEEPIDLE);
+  curl_easy_setopt(easy, CURLOPT_TCP_KEEPINTVL, HTTP_KEEPINTVL);
+  curl_easy_setopt(easy, CURLOPT_MAXAGE_CONN, HTTP_MAXAGE_CONN);
+  curl_easy_setopt(easy, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+  curl_easy_setopt(easy, CURLOPT_PIPEWAIT, 1L);
+  return easy;
+}
+
+CURLM *http_multi_init()
+{
+  CURLM *multi = curl_multi_init();
+  if (!multi) {
+    log_default("curl_multi_init()\n");
+    return NULL;
+  }
+
+  curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+  curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, HTTP_MAX_HOST_CONNS);
+  return multi;
+}
+
+static int64_t http_now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * Returns the state of the host in url, creating it on first use, or NULL
+ * if the table is full (such hosts are not limited).  Call with host_lock.
+ */
+static struct HttpHost *http_host(const char *url)
+{
+  const char *p = strstr(url, "://");
+  p = p ? p + 3 : url;
+  size_t n = strcspn(p, "/:?");
+  if (n > HTTP_HOST_LENGTH) {
+    n = HTTP_HOST_LENGTH;
+  }
+
+  for (size_t i = 0; i < nhosts; i++) {
+    if (strncmp(hosts[i].name, p, n) == 0 && hosts[i].name[n] == 0) {
+      return &hosts[i];
+    }
+  }
+  if (nhosts == HTTP_MAX_HOSTS) {
+    return NULL;
+  }
+
+  struct HttpHost *h = &hosts[nhosts++];
+  memcpy(h->name, p, n);
+  h->name[n] = 0;
+  h->rate = HTTP_RATE, h->tokens = HTTP_BURST, h->refill = http_now();
+  h->failures = 0, h->open_until = 0;
+  h->latency = 0, h->errors = 0, h->used = 0;
+  return h;
+}
+
+static const char *http_path(const char *url)
+{
+  const char *p = strstr(url, "://");
+  p = p ? p + 3 : url;
+  return p + strcspn(p, "/");
+}
+
+/*
+ * Query parameters carrying the time of the request, left out of the hash.
+ * period1 stays in: it picks the range, and ranges must not collide.
+ */
+static const char * const http_volatile[] = { "period2=" };
+
+static bool http_volatile_param(const char *p)
+{
+  for (size_t i = 0; i < sizeof(http_volatile) / sizeof(http_volatile[0]); i++) {
+    if (strncmp(p, http_volatile[i], strlen(http_volatile[i])) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/*
+ * Names the recording of url, so that a request made again later replays
+ * it even though its period runs up to a different now (period2).  The body of a
+ * POST, if any, is part of the request and of its name.
+ */
+static uint64_t http_hash(const char *url, const char *body)
+{
+  const char *p = http_path(url);
+
+  uint64_t h = 0xcbf29ce484222325ULL; /* FNV-1a */
+  while (*p) {
+    if ((*p == '?' || *p == '&') && http_volatile_param(p + 1)) {
+      p += 1 + strcspn(p + 1, "&");
+      continue;
+    }
+    h = (h ^ (unsigned char) *p++) * 0x100000001b3ULL;
+  }
+  for (p = body; p && *p; p++) {
+    h = (h ^ (unsigned char) *p) * 0x100000001b3ULL;
+  }
+  return h;
+}
+
+static void http_sleep(int64_t wait)
+{
+  struct timespec ts = { .tv_sec = wait / 1000000, .tv_nsec = wait % 1000000 * 1000 };
+  nanosleep(&ts, NULL);
+}
+
+/* Forwards the body to the transfer's sink, recording it or holding it */
+static size_t http_tee(char *p, size_t size, size_t nmemb, void *user)
+{
+  struct HttpTee *t = user;
+  if (replay && bandwidth) {
+    return http_buffer_write(p, size, nmemb, &t->held);
+  }
+  size_t n = t->write(p, size, nmemb, t->data);
+  if (t->file && fwrite(p, size, nmemb, t->file) != nmemb) {
+    log_default("fwrite(%s): %s\n", t->path, strerror(errno));
+    fclose(t->file);
+    remove(t->path);
+    t->file = NULL;
+  }
+  return n;
+}
+
+/**
+ * Closes the recording of a finished transfer, keeping it only if the
+ * response is worth replaying.
+ */
+static void http_untee(CURL *easy, bool keep)
+{
+  pthread_mutex_lock(&tee_lock);
+  struct HttpTee **pt = &tees;
+  while (*pt && (*pt)->easy != easy) {
+    pt = &(*pt)->next;
+  }
+  struct HttpTee *t = *pt;
+  if (t) {
+    *pt = t->next;
+  }
+  pthread_mutex_unlock(&tee_lock);
+
+  if (t && t->file) {
+    fclose(t->file);
+    char path[HTTP_PATH_LENGTH + 1];
+    snprintf(path, sizeof(path), "%.*s", (int) (strlen(t->path) - 4), t->path); /* Strip ".tmp" */
+    if (!keep || rename(t->path, path) != 0) {
+      remove(t->path);
+    }
+  }
+  if (t) {
+    http_buffer_release(&t->held);
+  }
+  free(t);
+}
+
+/**
+ * Routes the body of easy through http_tee(), writing a copy to path unless
+ * it is NULL.  The tee lasts until http_report() of the transfer.
+ */
+static void http_tee_open(CURL *easy, curl_write_callback write, void *data, const char *path)
+{
+  http_untee(easy, false);
+  struct HttpTee *t = calloc(1, sizeof(struct HttpTee));
+  if (!t) {
+    log_default("%s:%d: calloc(): %s\n", __FILE__, __LINE__, strerror(errno));
+    return;
+  }
+  t->easy = easy, t->write = write, t->data = data;
+  t->start = http_now();
+  if (path) {
+    snprintf(t->path, sizeof(t->path), "%s", path);
+    if (!(t->file = fopen(t->path, "wb"))) {
+      log_default("fopen(%s): %s\n", t->path, strerror(errno));
+    }
+  }
+
+  pthread_mutex_lock(&tee_lock);
+  t->next = tees, tees = t;
+  pthread_mutex_unlock(&tee_lock);
+
+  curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, http_tee);
+  curl_easy_setopt(easy, CURLOPT_WRITEDATA, t);
+}
+
+/**
+ * Points easy at url, delivering the body to write(data).  When recording,
+ * the body is also written to the record directory; when replaying, url is
+ * served from the replay directory instead.
+ */
+void http_prepare(CURL *easy, const char *url, curl_write_callback write, void *data)
+{
+  http_prepare_post(easy, url, NULL, write, data);
+}
+
+/**
+ * http_prepare() for a POST of body, which is not copied and must outlive
+ * the transfer; a NULL body is a GET.  Recordings are named by the body as
+ * well as the URL.
+ */
+void http_prepare_post(CURL *easy, const char *url, const char *body, curl_write_callback write, void *data)
+{
+  char path[HTTP_PATH_LENGTH + 1];
+  uint64_t hash = http_hash(url, body);
+  curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, write);
+  curl_easy_setopt(easy, CURLOPT_WRITEDATA, data);
+
+  if (replay) {
+    snprintf(path, sizeof(path), "file://%s/%016" PRIx64, replay, hash);
+    curl_easy_setopt(easy, CURLOPT_URL, path);
+    if (bandwidth) {
+      http_tee_open(easy, write, data, NULL);
+    }
+    return;
+  }
+  if (origin) {
+    snprintf(path, sizeof(path), "%s%s", origin, http_path(url));
+    curl_easy_setopt(easy, CURLOPT_URL, path);
+  } else {
+    curl_easy_setopt(easy, CURLOPT_URL, url);
+  }
+  if (body) {
+    curl_easy_setopt(easy, CURLOPT_POSTFIELDS, body);
+  }
+  if (!record) {
+    return;
+  }
+
+  snprintf(path, sizeof(path), "%s/%016" PRIx64 ".tmp", record, hash);
+  http_tee_open(easy, write, data, path);
+
+  pthread_mutex_lock(&tee_lock);
+  snprintf(path, sizeof(path), "%s/index", record);
+  FILE *index = fopen(path, "a");
+  if (index) {
+    fprintf(index, "%016" PRIx64 " %s%s%s\n", hash, url, body ? " " : "", body ? body : "");
+    fclose(index);
+  }
+  pthread_mutex_unlock(&tee_lock);
+}
+
+/**
+ * Hands the body of a completed transfer on to its sink as far as the
+ * replay bandwidth allows by now, counted from the start of that transfer
+ * alone.  Returns the microseconds until more of it is due, or 0 once all
+ * of it was delivered (always, unless replaying under a cap).  Call before
+ * http_report(), which ends the tee.
+ */
+int64_t http_drain(CURL *easy)
+{
+  if (!replay || !bandwidth) {
+    return 0;
+  }
+
+  pthread_mutex_lock(&tee_lock);
+  struct HttpTee *t = tees;
+  while (t && t->easy != easy) {
+    t = t->next;
+  }
+  pthread_mutex_unlock(&tee_lock);
+  if (!t || t->sent == t->held.size) {
+    return 0;
+  }
+
+  int64_t now = http_now();
+  size_t due = (size_t) ((now - t->start) * bandwidth / 1000000);
+  if (due > t->held.size) {
+    due = t->held.size;
+  }
+  if (due > t->sent) {
+    size_t n = t->write(t->held.data + t->sent, 1, due - t->sent, t->data);
+    if (n != due - t->sent) {
+      log_default("http_drain(): %zu of %zu bytes written\n", n, due - t->sent);
+      t->sent = t->held.size; /* The sink failed: drop the rest, its parser reports the error */
+      return 0;
+    }
+    t->sent = due;
+  }
+  if (t->sent == t->held.size) {
+    return 0;
+  }
+  size_t next = t->sent + CURL_MAX_WRITE_SIZE < t->held.size ? t->sent + CURL_MAX_WRITE_SIZE : t->held.size;
+  int64_t wait = t->start + (int64_t) (next * 1000000 / bandwidth) - now;
+  return wait > 0 ? wait : 1;
+}
+
+/**
+ * Blocking http_drain() for synchronous transfers.
+ */
+void http_drain_wait(CURL *easy)
+{
+  int64_t wait = 0;
+  while ((wait = http_drain(easy)) > 0) {
+    http_sleep(wait);
+  }
+}
+
+/**
+ * Simulated latency of every transfer when replaying, in microseconds.
+ */
+int64_t http_latency()
+{
+  return latency;
+}
+
+/**
+ * Takes a token for url.  Returns HTTP_OK if the request may start now,
+ * HTTP_AGAIN if it must wait *wait microseconds, or HTTP_BROKEN if the
+ * circuit is open for another *wait microseconds.
+ */
+int http_admit(const char *url, int64_t *wait)
+{
+  int status = HTTP_OK;
+  *wait = 0;
+  if (replay || origin) {
+    return status; /* Nothing upstream to protect */
+  }
+
+  pthread_mutex_lock(&host_lock);
+  struct HttpHost *h = http_host(url);
+  if (h) {
+    int64_t now = http_now();
+    if (h->open_until > now) {
+      *wait = h->open_until - now;
+      status = HTTP_BROKEN;
+    } else if (h->open_until) {
+      h->open_until = now + HTTP_BREAKER_COOLDOWN; /* Half-open: let one probe through */
+    } else {
+      h->tokens += h->rate * (now - h->refill) / 1e6;
+      if (h->tokens > HTTP_BURST) {
+        h->tokens = HTTP_BURST;
+      }
+      h->refill = now;
+      if (h->tokens >= 1.0) {
+        h->tokens -= 1.0;
+      } else {
+        *wait = (int64_t) ((1.0 - h->tokens) / h->rate * 1e6) + 1;
+        status = HTTP_AGAIN;
+      }
+    }
+  }
+  pthread_mutex_unlock(&host_lock);
+  return status;
+}
+
+/**
+ * Blocking http_admit() for synchronous transfers, including the simulated
+ * replay latency.  Returns HTTP_OK once a token was taken, or HTTP_BROKEN
+ * if the circuit is open.
+ */
+int http_wait(const char *url)
+{
+  int64_t wait = 0;
+  int status = HTTP_OK;
+  while ((status = http_admit(url, &wait)) == HTTP_AGAIN) {
+    http_sleep(wait);
+  }
+  if (status == HTTP_OK && latency) {
+    http_sleep(latency);
+  }
+  if (status == HTTP_BROKEN) {
+    log_default("http_wait(%s): circuit open\n", url);
+  }
+  return status;
+}
+
+/**
+ * Feeds the outcome of a transfer back into the limiter of its host.
+ * Returns HTTP_AGAIN if the transfer failed in a way worth retrying (429,
+ * 5xx or a transport error), HTTP_OK otherwise.
+ */
+int http_report(const char *url, CURL *easy, CURLcode result)
+{
+  long code = 0;
+  if (result == CURLE_OK) {
+    curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &code);
+  }
+  bool failed = result != CURLE_OK || code == 429 || code >= 500;
+  if (record || replay) {
+    http_untee(easy, !failed);
+  }
+  if (replay) {
+    if (result != CURLE_OK && result != CURLE_ABORTED_BY_CALLBACK) {
+      log_default("http_report(%s): not recorded\n", url);
+    }
+    return HTTP_OK; /* A missing recording will not appear on retry */
+  }
+  curl_off_t total = 0;
+  curl_easy_getinfo(easy, CURLINFO_TOTAL_TIME_T, &total);
+
+  pthread_mutex_lock(&host_lock);
+  struct HttpHost *h = http_host(url);
+  if (h) {
+    h->latency = h->used ? HTTP_EWMA * total + (1 - HTTP_EWMA) * h->latency : total;
+    h->errors = HTTP_EWMA * failed + (1 - HTTP_EWMA) * h->errors;
+    h->used = http_now();
+  }
+  if (h && failed) {
+    h->rate /= 2;
+    if (h->rate < HTTP_RATE_MIN) {
+      h->rate = HTTP_RATE_MIN;
+    }
+    h->tokens = 0;
+    if (++h->failures >= HTTP_BREAKER_FAILURES) {
+      h->open_until = http_now() + HTTP_BREAKER_COOLDOWN;
+      log_default("http_report(%s): circuit open after %d failures\n", h->name, h->failures);
+    }
+  } else if (h) {
+    h->rate += HTTP_RATE_STEP;
+    if (h->rate > HTTP_RATE_MAX) {
+      h->rate = HTTP_RATE_MAX;
+    }
+    h->failures = 0, h->open_until = 0;
+  }
+  pthread_mutex_unlock(&host_lock);
+
+  if (failed) {
+    log_default("http_report(%s): %ld %s\n", url, code, curl_easy_strerror(result));
+  }
+  return failed ? HTTP_AGAIN : HTTP_OK;
+}
+
+/**
+ * Microseconds to wait before retry number attempt: the server's
+ * Retry-After if it sent one, otherwise exponential backoff with equal
+ * jitter, capped at HTTP_BACKOFF_MAX.
+ */
+int64_t http_backoff(CURL *easy, int attempt)
+{
+  curl_off_t after = 0;
+  if (easy && curl_easy_getinfo(easy, CURLINFO_RETRY_AFTER, &after) == CURLE_OK && after > 0) {
+    return after * 1000000 < HTTP_BACKOFF_MAX ? after * 1000000 : HTTP_BACKOFF_MAX;
+  }
+
+  int64_t ceiling = HTTP_BACKOFF << (attempt < 16 ? attempt : 16);
+  if (ceiling > HTTP_BACKOFF_MAX) {
+    ceiling = HTTP_BACKOFF_MAX;
+  }
+  return ceiling / 2 + random() % (ceiling / 2 + 1);
+}
+
+/**
+ * Chooses among n equivalent hosts, given as URL prefixes, the one expected
+ * to answer soonest: EWMA latency inflated by the recent error rate, plus
+ * any wait for a token.  Hosts with an open circuit are avoided, and a host
+ * idle for HTTP_EXPLORE scores zero so a recovered host gets traffic back.
+ */
+size_t http_pick(const char * const *urls, size_t n)
+{
+  size_t best = 0;
+  double score = -1;
+
+  pthread_mutex_lock(&host_lock);
+  int64_t now = http_now();
+  for (size_t i = 0; i < n; i++) {
+    struct HttpHost *h = http_host(urls[i]);
+    double x = 0;
+    if (h && h->open_until > now) {
+      x = HTTP_BREAKER_COOLDOWN + (h->open_until - now);
+    } else if (h && now - h->used < HTTP_EXPLORE) {
+      x = h->latency * (1 + HTTP_ERROR_PENALTY * h->errors);
+      if (h->tokens < 1.0) {
+        x += (1.0 - h->tokens) / h->rate * 1e6;
+      }
+    }
+    if (score < 0 || x < score) {
+      best = i, score = x;
+    }
+  }
+  pthread_mutex_unlock(&host_lock);
+  return best;
+}
+
+static void http_buffer_acquire(struct HttpBuffer *buffer)
+{
+  pthread_mutex_lock(&pool_lock);
+  if (npool) {
+    *buffer = pool[--npool];
+  }
+  pthread_mutex_unlock(&pool_lock);
+  buffer->size = 0;
+}
+
+/**
+ * curl write callback appending to the struct HttpBuffer passed as user
+ * data.  Capacity at least doubles on each growth, so a body of n bytes
+ * costs O(log n) reallocations rather than one per chunk.
+ */
+size_t http_buffer_write(char *p, size_t size, size_t nmemb, void *user)
+{
+  size_t nsize = size * nmemb;
+  struct HttpBuffer *buffer = user;
+  if (!buffer->data) {
+    http_buffer_acquire(buffer);
+  }
+  if (buffer->size + nsize + 1 > buffer->capacity) {
+    size_t capacity = buffer->capacity ? buffer->capacity : HTTP_BUFFER_MIN;
+    while (buffer->size + nsize + 1 > capacity) {
+      capacity *= 2;
+    }
+    char *data = realloc(buffer->data, capacity);
+    if (!data) {
+      log_default("%s:%d: realloc(%zu): %s\n", __FILE__, __LINE__, capacity, strerror(errno));
+      return 0;
+    }
+    buffer->data = data, buffer->capacity = capacity;
+  }
+  memcpy(&buffer->data[buffer->size], p, nsize);
+  buffer->size += nsize;
+  buffer->data[buffer->size] = 0;
+  return nsize;
+}
+
+/* Returns the storage to the pool; the buffer is left empty and reusable */
+void http_buffer_release(struct HttpBuffer *buffer)
+{
+  if (buffer->data) {
+    bool pooled = false;
+    if (buffer->capacity <= HTTP_BUFFER_KEEP) {
+      pthread_mutex_lock(&pool_lock);
+      if (npool < HTTP_BUFFER_POOL) {
+        pool[npool++] = *buffer;
+        pooled = true;
+      }
+      pthread_mutex_unlock(&pool_lock);
+    }
+    if (!pooled) {
+      free(buffer->data);
+    }
+  }
+  buffer->data = NULL, buffer->size = 0, buffer->capacity = 0;
+}
+
+/* Hands the storage to the caller, who frees it */
+char *http_buffer_detach(struct HttpBuffer *buffer)
+{
+  char *data = buffer->data;
+  buffer->data = NULL, buffer->size = 0, buffer->capacity = 0;
+  return data;
+}
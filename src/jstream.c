@@ -0,0 +1,320 @@
+#include <string.h>
+
+#include "../include/jstream.h"
+
+enum
+{
+  JSTREAM_VALUE,   /*< between tokens */
+  JSTREAM_INSTRING,
+  JSTREAM_ESCAPE,
+  JSTREAM_UNICODE,
+  JSTREAM_INNUMBER,
+  JSTREAM_LITERAL,
+  JSTREAM_DONE,
+  JSTREAM_FAILED,
+};
+
+enum
+{
+  JSTREAM_EXPECT_VALUE,
+  JSTREAM_EXPECT_KEY,
+  JSTREAM_EXPECT_COLON,
+  JSTREAM_EXPECT_COMMA,
+};
+
+void jstream_init(struct JStream *j, jstream_handler handler, void *user)
+{
+  memset(j, 0, sizeof(struct JStream));
+  j->handler = handler;
+  j->user = user;
+  j->state = JSTREAM_VALUE;
+  j->expect = JSTREAM_EXPECT_VALUE;
+}
+
+static int jstream_emit(struct JStream *j, enum JStreamEvent e)
+{
+  j->token[j->length] = 0;
+  int status = j->handler(j->user, e, j->token, j->length);
+  j->length = 0;
+  return status == 0 ? JSTREAM_OK : JSTREAM_ERROR;
+}
+
+static void jstream_append(struct JStream *j, char c)
+{
+  if (j->length < JSTREAM_TOKEN_LENGTH) {
+    j->token[j->length++] = c;
+  }
+}
+
+static void jstream_utf8(struct JStream *j, uint32_t c)
+{
+  if (c < 0x80) {
+    jstream_append(j, c);
+  } else if (c < 0x800) {
+    jstream_append(j, 0xC0 | c >> 6);
+    jstream_append(j, 0x80 | (c & 0x3F));
+  } else if (c < 0x10000) {
+    jstream_append(j, 0xE0 | c >> 12);
+    jstream_append(j, 0x80 | (c >> 6 & 0x3F));
+    jstream_append(j, 0x80 | (c & 0x3F));
+  } else {
+    jstream_append(j, 0xF0 | c >> 18);
+    jstream_append(j, 0x80 | (c >> 12 & 0x3F));
+    jstream_append(j, 0x80 | (c >> 6 & 0x3F));
+    jstream_append(j, 0x80 | (c & 0x3F));
+  }
+}
+
+static bool jstream_array(const struct JStream *j)
+{
+  return j->depth > 0 && (j->arrays >> (j->depth - 1) & 1);
+}
+
+/* A value is complete: the document ends or a separator follows */
+static void jstream_value(struct JStream *j)
+{
+  j->state = j->depth == 0 ? JSTREAM_DONE : JSTREAM_VALUE;
+  j->expect = JSTREAM_EXPECT_COMMA;
+  j->first = false;
+}
+
+static int jstream_open(struct JStream *j, bool array)
+{
+  if (j->depth == JSTREAM_DEPTH) {
+    return JSTREAM_ERROR;
+  }
+  if (array) {
+    j->arrays |= (uint64_t) 1 << j->depth;
+  } else {
+    j->arrays &= ~((uint64_t) 1 << j->depth);
+  }
+  j->depth++;
+  j->expect = array ? JSTREAM_EXPECT_VALUE : JSTREAM_EXPECT_KEY;
+  j->first = true;
+  return jstream_emit(j, array ? JSTREAM_ARRAY : JSTREAM_OBJECT);
+}
+
+static int jstream_close(struct JStream *j, bool array)
+{
+  if (j->depth == 0 || jstream_array(j) != array) {
+    return JSTREAM_ERROR;
+  }
+  j->depth--;
+  jstream_value(j);
+  return jstream_emit(j, array ? JSTREAM_ARRAY_END : JSTREAM_OBJECT_END);
+}
+
+static int jstream_number(struct JStream *j)
+{
+  jstream_value(j);
+  return jstream_emit(j, JSTREAM_NUMBER);
+}
+
+static int jstream_hex(char c)
+{
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  } else if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  } else if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+static int jstream_token(struct JStream *j, char c)
+{
+  switch (j->expect) {
+  case JSTREAM_EXPECT_VALUE:
+    switch (c) {
+    case '{':
+      return jstream_open(j, false);
+    case '[':
+      return jstream_open(j, true);
+    case ']':
+      return j->first ? jstream_close(j, true) : JSTREAM_ERROR;
+    case '"':
+      j->state = JSTREAM_INSTRING;
+      return JSTREAM_OK;
+    case 't':
+      j->literal = "true";
+      break;
+    case 'f':
+      j->literal = "false";
+      break;
+    case 'n':
+      j->literal = "null";
+      break;
+    default:
+      if (c == '-' || (c >= '0' && c <= '9')) {
+        j->state = JSTREAM_INNUMBER;
+        jstream_append(j, c);
+        return JSTREAM_OK;
+      }
+      return JSTREAM_ERROR;
+    }
+    j->state = JSTREAM_LITERAL;
+    j->digits = 1;
+    return JSTREAM_OK;
+  case JSTREAM_EXPECT_KEY:
+    if (c == '"') {
+      j->state = JSTREAM_INSTRING;
+      return JSTREAM_OK;
+    }
+    return c == '}' && j->first ? jstream_close(j, false) : JSTREAM_ERROR;
+  case JSTREAM_EXPECT_COLON:
+    if (c == ':') {
+      j->expect = JSTREAM_EXPECT_VALUE;
+      j->first = false;
+      return JSTREAM_OK;
+    }
+    return JSTREAM_ERROR;
+  case JSTREAM_EXPECT_COMMA:
+    if (c == ',') {
+      j->expect = jstream_array(j) ? JSTREAM_EXPECT_VALUE : JSTREAM_EXPECT_KEY;
+      return JSTREAM_OK;
+    } else if (c == '}' || c == ']') {
+      return jstream_close(j, c == ']');
+    }
+    return JSTREAM_ERROR;
+  }
+  return JSTREAM_ERROR;
+}
+
+/* The string is a key if the enclosing object expects one */
+static int jstream_string(struct JStream *j)
+{
+  if (j->expect == JSTREAM_EXPECT_KEY) {
+    j->state = JSTREAM_VALUE;
+    j->expect = JSTREAM_EXPECT_COLON;
+    return jstream_emit(j, JSTREAM_KEY);
+  }
+  jstream_value(j);
+  return jstream_emit(j, JSTREAM_STRING);
+}
+
+static int jstream_escape(struct JStream *j, char c)
+{
+  static const char escapes[] = "\"\"\\\\//b\bf\fn\nr\rt\t";
+  if (c == 'u') {
+    j->state = JSTREAM_UNICODE;
+    j->code = 0, j->digits = 0;
+    return JSTREAM_OK;
+  }
+  for (const char *e = escapes; *e; e += 2) {
+    if (*e == c) {
+      jstream_append(j, e[1]);
+      j->state = JSTREAM_INSTRING;
+      return JSTREAM_OK;
+    }
+  }
+  return JSTREAM_ERROR;
+}
+
+static int jstream_unicode(struct JStream *j, char c)
+{
+  int x = jstream_hex(c);
+  if (x < 0) {
+    return JSTREAM_ERROR;
+  }
+  j->code = j->code << 4 | x;
+  if (++j->digits < 4) {
+    return JSTREAM_OK;
+  }
+  j->state = JSTREAM_INSTRING;
+  if (j->code >= 0xD800 && j->code < 0xDC00) {
+    j->high = j->code;
+  } else if (j->code >= 0xDC00 && j->code < 0xE000 && j->high) {
+    jstream_utf8(j, 0x10000 + ((j->high - 0xD800) << 10) + (j->code - 0xDC00));
+    j->high = 0;
+  } else {
+    jstream_utf8(j, j->code);
+    j->high = 0;
+  }
+  return JSTREAM_OK;
+}
+
+int jstream_feed(struct JStream *j, const char *p, size_t n)
+{
+  for (size_t i = 0; i < n; ) {
+    char c = p[i];
+    int status = JSTREAM_OK;
+    switch (j->state) {
+    case JSTREAM_VALUE:
+      if (c != ' ' && c != '\t' && c != '\n' && c != '\r') {
+        status = jstream_token(j, c);
+      }
+      break;
+    case JSTREAM_INSTRING:
+      if (c == '"') {
+        status = jstream_string(j);
+      } else if (c == '\\') {
+        j->state = JSTREAM_ESCAPE;
+      } else {
+        /* Copy the run up to the next quote or escape in one go */
+        size_t k = i;
+        while (k < n && p[k] != '"' && p[k] != '\\') {
+          k++;
+        }
+        size_t m = k - i;
+        if (m > JSTREAM_TOKEN_LENGTH - j->length) {
+          m = JSTREAM_TOKEN_LENGTH - j->length;
+        }
+        memcpy(&j->token[j->length], &p[i], m);
+        j->length += m;
+        j->offset += k - i;
+        i = k;
+        continue;
+      }
+      break;
+    case JSTREAM_ESCAPE:
+      status = jstream_escape(j, c);
+      break;
+    case JSTREAM_UNICODE:
+      status = jstream_unicode(j, c);
+      break;
+    case JSTREAM_INNUMBER:
+      if ((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-') {
+        jstream_append(j, c);
+        break;
+      }
+      status = jstream_number(j);
+      if (status != JSTREAM_OK) {
+        break;
+      }
+      continue; /* c ends the number and is a token of its own */
+    case JSTREAM_LITERAL:
+      if (c != j->literal[j->digits]) {
+        status = JSTREAM_ERROR;
+      } else if (!j->literal[++j->digits]) {
+        enum JStreamEvent e = *j->literal == 't' ? JSTREAM_TRUE : *j->literal == 'f' ? JSTREAM_FALSE : JSTREAM_NULL;
+        jstream_value(j);
+        status = jstream_emit(j, e);
+      }
+      break;
+    case JSTREAM_DONE:
+      if (c != ' ' && c != '\t' && c != '\n' && c != '\r') {
+        status = JSTREAM_ERROR;
+      }
+      break;
+    default:
+      status = JSTREAM_ERROR;
+      break;
+    }
+    if (status != JSTREAM_OK) {
+      j->state = JSTREAM_FAILED;
+      return JSTREAM_ERROR;
+    }
+    i++, j->offset++;
+  }
+  return JSTREAM_OK;
+}
+
+/* Completes a document whose last token may still be pending */
+int jstream_end(struct JStream *j)
+{
+  if (j->state == JSTREAM_INNUMBER && j->depth == 0 && jstream_number(j) != JSTREAM_OK) {
+    j->state = JSTREAM_FAILED;
+  }
+  return j->state == JSTREAM_DONE ? JSTREAM_OK : JSTREAM_ERROR;
+}
@@ -1,6 +1,12 @@
 /* #define _GNU_SOURCE */
 
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <locale.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
 
 #include <curl/curl.h>
 #include <gmodule.h>
@@ -8,6 +14,8 @@
 #include <libxml/parser.h>
 #include <libxml/tree.h>
 
+#include "../include/http.h"
+#include "../include/jstream.h"
 #include "../include/log.h"
 #include "../include/yql.h"
 
@@ -17,6 +25,8 @@
 
 static Log logger = NULL;
 
+static locale_t csv_locale = (locale_t) 0; /*< "C", for numbers in CSV bodies */
+
 struct YError yql_error;
 
 GHashTable *yql_quotes = NULL;         /*< YString -> struct YQuote * */
@@ -25,13 +35,238 @@ GHashTable *yql_charts = NULL;         /*< YString -> struct YChart * */
 GHashTable *yql_optionChains = NULL;   /*< YString -> struct YOptionChain * */
 GHashTable *yql_headlines = NULL;      /*< YString -> struct YHeadline * */
 
-struct JsonBuffer
+static struct YFundamentals yql_fundamentals;
+static GHashTable *yql_fundamental_rows = NULL; /*< YString -> row + 1 */
+
+/**
+ * Bump allocator owning a request's temporaries: the request itself, its
+ * URL, cache key and symbol, and the scratch used to build them.  All of it
+ * is released by one YArena_reset().  Blocks are recycled through a small
+ * per-thread cache, so steady-state requests do not touch the shared heap
+ * and threads fetching concurrently do not contend in the allocator.
+ */
+#define YARENA_BLOCK 8192 /*< bytes */
+#define YARENA_SPARE 8    /*< blocks cached per thread */
+
+struct YArenaBlock
+{
+  struct YArenaBlock *next;
+  size_t      used;
+  size_t      capacity;
+  max_align_t data[];
+};
+
+struct YArena
+{
+  struct YArenaBlock *head;
+};
+
+struct YArenaCache
+{
+  struct YArenaBlock *spare;
+  size_t              count;
+};
+
+static pthread_key_t yarena_key;
+
+static void YArena_drain(void *p)
+{
+  struct YArenaCache *cache = p;
+  while (cache->spare) {
+    struct YArenaBlock *b = cache->spare;
+    cache->spare = b->next;
+    free(b);
+  }
+  free(cache);
+}
+
+static struct YArenaCache *YArena_cache()
+{
+  struct YArenaCache *cache = pthread_getspecific(yarena_key);
+  if (!cache) {
+    cache = calloc(1, sizeof(struct YArenaCache));
+    if (cache) {
+      pthread_setspecific(yarena_key, cache);
+    }
+  }
+  return cache;
+}
+
+static struct YArenaBlock *YArena_block(size_t n)
+{
+  struct YArenaCache *cache = YArena_cache();
+  struct YArenaBlock *b = NULL;
+  if (n <= YARENA_BLOCK && cache && cache->spare) {
+    b = cache->spare;
+    cache->spare = b->next, cache->count--;
+  } else {
+    size_t capacity = n > YARENA_BLOCK ? n : YARENA_BLOCK;
+    b = malloc(sizeof(struct YArenaBlock) + capacity);
+    if (!b) {
+      log_error(logger, "%s:%d: malloc(%zu): %s\n", __FILE__, __LINE__, capacity, strerror(errno));
+      return NULL;
+    }
+    b->capacity = capacity;
+  }
+  b->used = 0;
+  return b;
+}
+
+static void *YArena_alloc(struct YArena *a, size_t n)
+{
+  n = (n + sizeof(max_align_t) - 1) & ~(sizeof(max_align_t) - 1);
+  struct YArenaBlock *b = a->head;
+  if (!b || b->capacity - b->used < n) {
+    b = YArena_block(n);
+    if (!b) {
+      return NULL;
+    }
+    b->next = a->head, a->head = b;
+  }
+  void *p = (char *) b->data + b->used;
+  b->used += n;
+  return p;
+}
+
+static char *YArena_strndup(struct YArena *a, const char *s, size_t n)
+{
+  n = strnlen(s, n);
+  char *p = YArena_alloc(a, n + 1);
+  if (p) {
+    memcpy(p, s, n);
+    p[n] = 0;
+  }
+  return p;
+}
+
+/* Formats straight into the free tail of the current block; a second pass is only needed when it does not fit */
+static char *YArena_vsprintf(struct YArena *a, const char *fmt, va_list ap)
+{
+  if (!a->head && !YArena_alloc(a, 0)) {
+    return NULL;
+  }
+  struct YArenaBlock *b = a->head;
+  char *p = (char *) b->data + b->used;
+  va_list args;
+  va_copy(args, ap);
+  int n = vsnprintf(p, b->capacity - b->used, fmt, ap);
+  if (n < 0) {
+    log_error(logger, "vsnprintf(%s)\n", fmt);
+    p = NULL;
+  } else if ((size_t) n < b->capacity - b->used) {
+    YArena_alloc(a, n + 1);
+  } else if ((p = YArena_alloc(a, n + 1))) {
+    vsnprintf(p, n + 1, fmt, args);
+  }
+  va_end(args);
+  return p;
+}
+
+static char *YArena_sprintf(struct YArena *a, const char *fmt, ...)
+{
+  va_list ap;
+  va_start(ap, fmt);
+  char *str = YArena_vsprintf(a, fmt, ap);
+  va_end(ap);
+  return str;
+}
+
+/* Releases every allocation at once, keeping standard blocks for reuse by this thread */
+static void YArena_reset(struct YArena *a)
+{
+  struct YArenaCache *cache = YArena_cache();
+  for (struct YArenaBlock *b = a->head, *next = NULL; b; b = next) {
+    next = b->next;
+    if (cache && b->capacity == YARENA_BLOCK && cache->count < YARENA_SPARE) {
+      b->next = cache->spare, cache->spare = b, cache->count++;
+    } else {
+      free(b);
+    }
+  }
+  a->head = NULL;
+}
+
+struct YRequest;
+
+/**
+ * How a response is consumed: write receives the body as it arrives, with
+ * the request as user data; parse completes once the transfer is done; and
+ * discard drops partial state before a retry or when the request is freed.
+ */
+struct YFormat
+{
+  curl_write_callback write;
+  int  (*parse)(struct YRequest *);
+  void (*discard)(struct YRequest *);
+};
+
+#define YCSV_LINE_LENGTH 255
+
+/* Allocated from its own arena, together with url, key and symbol */
+struct YRequest
+{
+  struct YArena arena;
+  CURL   *easy;
+  char   *url;
+  char   *key;
+  char   *symbol;
+  const struct YFormat *format;
+  const void *user;   /*< what format writes to, if not the caches */
+  void   *stream;     /*< incremental parser state, if any */
+  struct HttpBuffer buffer;
+  bool    active;     /*< added to the multi handle */
+  bool    held;       /*< completed, its body still draining, see http_drain() */
+  CURLcode result;    /*< of the held transfer */
+  int     attempts;
+  int64_t not_before; /*< monotonic microseconds */
+};
+
+struct YFlight
+{
+  pthread_t owner;
+  bool      done;
+  int       status;
+  int64_t   time;
+};
+
+struct YMulti
 {
-  char   *data;
-  size_t  size;
+  CURLM     *handle;
+  GPtrArray *requests; /*< struct YRequest * */
 };
 
-static CURL *easy = NULL;
+#define YMULTI_TIMEOUT 1000
+#define YFLIGHT_LINGER 2000000 /*< microseconds */
+
+/**
+ * Freshness of cached responses, in seconds, by endpoint.  Endpoints not
+ * listed, or with a zero TTL, are always fetched.
+ */
+static const struct
+{
+  const char *prefix;
+  int64_t     ttl;
+} yql_ttls[] = {
+  { Y_QUOTESUMMARY, YTTL_QUOTESUMMARY },
+  { Y_QUOTE,        YTTL_QUOTE        },
+  { Y_SPARK,        YTTL_CHART        },
+  { Y_CHART,        YTTL_CHART        },
+  { Y_OPTIONS,      YTTL_OPTIONS      },
+  { Y_HEADLINE,     YTTL_HEADLINE     },
+  { Y_TIMESERIES,   YTTL_TIMESERIES   },
+};
+
+static CURL  *easy = NULL;
+static struct YMulti multi = { NULL, NULL };      /*< foreground, drained by yql_multi_end() */
+static struct YMulti revalidate = { NULL, NULL }; /*< background, progressed by yql_poll() */
+static int    multi_depth = 0;
+
+static GHashTable *yql_stamps = NULL;    /*< normalized URL -> int64_t fetch time */
+static pthread_mutex_t stamp_lock = PTHREAD_MUTEX_INITIALIZER; /*< bulk downloads run off the UI thread */
+
+static GHashTable *yql_flights = NULL;   /*< normalized URL -> struct YFlight * */
+static pthread_mutex_t flight_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  flight_cond = PTHREAD_COND_INITIALIZER;
 /* static char errbuf[CURL_ERROR_SIZE]; */
 
 static int min(int x, int y)
@@ -39,6 +274,11 @@ static int min(int x, int y)
   return x <= y ? x : y;
 }
 
+static int64_t min64(int64_t x, int64_t y)
+{
+  return x < y ? x : y;
+}
+
 static int max(int x, int y)
 {
   return x >= y ? x : y;
@@ -207,156 +447,424 @@ static size_t json_double_rarray(JsonReader *r, const char *n, double *v, size_t
   return json_array(r, n, v, -1, vn, sizeof(double), json_double);
 }
 
-static struct YQuote *json_quote(JsonReader *r, const char *s _U_)
+enum YFieldType
 {
-  YString symbol;
-  json_string (r, "symbol", symbol);
-  struct YQuote *q = ght_get(yql_quotes, symbol, sizeof(struct YQuote));
-
-  json_double (r, "ask", &q->ask);
-  json_int    (r, "askSize", &q->askSize);
-  json_string (r, "averageAnalystRating", q->averageAnalystRating);
-  json_int    (r, "averageDailyVolume10Day", &q->averageDailyVolume10Day);
-  json_int    (r, "averageDailyVolume3Month", &q->averageDailyVolume3Month);
-  json_double (r, "bid", &q->bid);
-  json_int    (r, "bidSize", &q->bidSize);
-  json_double (r, "bookValue", &q->bookValue);
-  json_string (r, "currency", q->currency);
-  json_string (r, "displayName", q->displayName);
-  json_int    (r, "dividendDate", &q->dividendDate);
-  json_int    (r, "earningsTimestamp", &q->earningsTimestamp);
-  json_int    (r, "earningsTimestampEnd", &q->earningsTimestampEnd);
-  json_int    (r, "earningsTimestampStart", &q->earningsTimestampStart);
-  json_double (r, "epsCurrentYear", &q->epsCurrentYear);
-  json_double (r, "epsForward", &q->epsForward);
-  json_double (r, "epsTrailingTwelveMonths", &q->epsTrailingTwelveMonths);
-  json_bool   (r, "esgPopulated", &q->esgPopulated);
-  json_string (r, "exchange", q->exchange);
-  json_int    (r, "exchangeDataDelayedBy", &q->exchangeDataDelayedBy);
-  json_string (r, "exchangeTimezoneName", q->exchangeTimezoneName);
-  json_string (r, "exchangeTimezoneShortName", q->exchangeTimezoneShortName);
-  json_double (r, "fiftyDayAverage", &q->fiftyDayAverage);
-  json_double (r, "fiftyDayAverageChange", &q->fiftyDayAverageChange);
-  json_double (r, "fiftyDayAverageChangePercent", &q->fiftyDayAverageChangePercent);
-  json_double (r, "fiftyTwoWeekHigh", &q->fiftyTwoWeekHigh);
-  json_double (r, "fiftyTwoWeekHighChange", &q->fiftyTwoWeekHighChange);
-  json_double (r, "fiftyTwoWeekHighChangePercent", &q->fiftyTwoWeekHighChangePercent);
-  json_double (r, "fiftyTwoWeekLow", &q->fiftyTwoWeekLow);
-  json_double (r, "fiftyTwoWeekLowChange", &q->fiftyTwoWeekLowChange);
-  json_double (r, "fiftyTwoWeekLowChangePercent", &q->fiftyTwoWeekLowChangePercent);
-  json_string (r, "fiftyTwoWeekRange", q->fiftyTwoWeekRange);
-  json_string (r, "financialCurrency", q->financialCurrency);
-  json_int    (r, "firstTradeDateMilliseconds", &q->firstTradeDateMilliseconds);
-  json_double (r, "forwardPE", &q->forwardPE);
-  json_string (r, "fullExchangeName", q->fullExchangeName);
-  json_int    (r, "gmtOffSetMilliseconds", &q->gmtOffSetMilliseconds);
-  json_string (r, "language", q->language);
-  json_string (r, "longName", q->longName);
-  json_string (r, "market", q->market);
-  json_int    (r, "marketCap", &q->marketCap);
-  json_string (r, "marketState", q->marketState);
-  json_double (r, "postMarketChange", &q->postMarketChange);
-  json_double (r, "postMarketChangePercent", &q->postMarketChangePercent);
-  json_double (r, "postMarketPrice", &q->postMarketPrice);
-  json_int    (r, "postMarketTime", &q->postMarketTime);
-  json_double (r, "preMarketChange", &q->preMarketChange);
-  json_double (r, "preMarketChangePercent", &q->preMarketChangePercent);
-  json_double (r, "preMarketPrice", &q->preMarketPrice);
-  json_int    (r, "preMarketTime", &q->preMarketTime);
-  json_double (r, "priceEpsCurrentYear", &q->priceEpsCurrentYear);
-  json_int    (r, "priceHint", &q->priceHint);
-  json_double (r, "priceToBook", &q->priceToBook);
-  json_string (r, "quoteSourceName", q->quoteSourceName);
-  json_string (r, "quoteType", q->quoteType);
-  json_string (r, "region", q->region);
-  json_double (r, "regularMarketChange", &q->regularMarketChange);
-  json_double (r, "regularMarketChangePercent", &q->regularMarketChangePercent);
-  json_double (r, "regularMarketDayHigh", &q->regularMarketDayHigh);
-  json_double (r, "regularMarketDayLow", &q->regularMarketDayLow);
-  json_string (r, "regularMarketDayRange", q->regularMarketDayRange);
-  json_double (r, "regularMarketOpen", &q->regularMarketOpen);
-  json_double (r, "regularMarketPreviousClose", &q->regularMarketPreviousClose);
-  json_double (r, "regularMarketPrice", &q->regularMarketPrice);
-  json_int    (r, "regularMarketTime", &q->regularMarketTime);
-  json_int    (r, "regularMarketVolume", &q->regularMarketVolume);
-  json_int    (r, "sharesOutstanding", &q->sharesOutstanding);
-  json_string (r, "shortName", q->shortName);
-  json_int    (r, "sourceInterval", &q->sourceInterval);
-  json_string (r, "symbol", q->symbol);
-  json_bool   (r, "tradeable", &q->tradeable);
-  json_double (r, "trailingAnnualDividendRate", &q->trailingAnnualDividendRate);
-  json_double (r, "trailingAnnualDividendYield", &q->trailingAnnualDividendYield);
-  json_double (r, "trailingPE", &q->trailingPE);
-  json_bool   (r, "triggerable", &q->triggerable);
-  json_double (r, "twoHundredDayAverage", &q->twoHundredDayAverage);
-  json_double (r, "twoHundredDayAverageChange", &q->twoHundredDayAverageChange);
-  json_double (r, "twoHundredDayAverageChangePercent", &q->twoHundredDayAverageChangePercent);
-
-  /* QuoteType.CRYPTOCURRENCY */
-  json_int    (r, "circulatingSupply", &q->circulatingSupply);
-  json_string (r, "fromCurrency", q->fromCurrency);
-  json_string (r, "lastMarket", q->lastMarket);
-  json_int    (r, "startDate", &q->startDate);
-  json_string (r, "toCurrency", q->toCurrency);
-  json_int    (r, "volume24Hr", &q->volume24Hr);
-  json_int    (r, "volumeAllCurrencies", &q->volumeAllCurrencies);
-
-  /* QuoteType.ETF */
-  json_double (r, "trailingThreeMonthNavReturns", &q->trailingThreeMonthNavReturns);
-  json_double (r, "trailingThreeMonthReturns", &q->trailingThreeMonthReturns);
-  json_double (r, "ytdReturn", &q->ytdReturn);
-
-  /* QuoteType.OPTION */
-  json_string (r, "customPriceAlertConfidence", q->customPriceAlertConfidence);
-  json_int    (r, "expireDate", &q->expireDate);
-  json_string (r, "expireIsoDate", q->expireIsoDate);
-  json_int    (r, "openInterest", &q->openInterest);
-  json_double (r, "strike", &q->strike);
-  json_string (r, "underlyingSymbol", q->underlyingSymbol);
+  YFIELD_BOOL,
+  YFIELD_INT,
+  YFIELD_DOUBLE,
+  YFIELD_STRING,
+};
 
-  return q;
+/**
+ * Descriptor of a decoded member: its JSON name, where it goes and how
+ * large it is, which bounds strings.  Tables of these are expanded from the
+ * X-macro lists below and looked up through a struct YFieldIndex.
+ */
+struct YField
+{
+  const char     *name;
+  enum YFieldType type;
+  size_t          offset;
+  size_t          size;
+};
+
+#define YFIELD(S, t, n) { #n, YFIELD_##t, offsetof(S, n), sizeof(((S *) 0)->n) },
+#define YFIELDS(a)      a, sizeof(a) / sizeof(a[0])
+
+/**
+ * Perfect hash over the names of a field table (hash and displace): names
+ * fall into buckets by one hash, and each bucket gets the seed of a second
+ * hash that sends all of its names to distinct slots.  Built once by
+ * yql_init(), a lookup costs two hashes and one comparison.
+ */
+#define YFIELD_SLOTS   256
+#define YFIELD_BUCKETS 128
+#define YFIELD_SEEDS   65535
+
+struct YFieldIndex
+{
+  const struct YField *fields;
+  size_t   count;
+  size_t   mask;
+  size_t   buckets;
+  uint16_t seeds[YFIELD_BUCKETS];
+  uint8_t  slots[YFIELD_SLOTS]; /*< field index + 1, 0 if empty */
+};
+
+static uint32_t YField_hash(const char *s, uint32_t seed)
+{
+  uint32_t h = 2166136261u ^ seed;
+  while (*s) {
+    h ^= (unsigned char) *s++;
+    h *= 16777619u;
+  }
+  h ^= h >> 15;
+  h *= 0x2C1B3C6Du;
+  return h ^ h >> 12;
+}
+
+static int YFieldIndex_build(struct YFieldIndex *x, const struct YField *fields, size_t n)
+{
+  size_t slots = 1;
+  while (slots < 2 * n) {
+    slots <<= 1;
+  }
+  if (slots > YFIELD_SLOTS || n / 2 + 1 > YFIELD_BUCKETS) {
+    return YERROR_CERR;
+  }
+  memset(x, 0, sizeof(struct YFieldIndex));
+  x->fields = fields, x->count = n, x->mask = slots - 1, x->buckets = n / 2 + 1;
+
+  /* Largest buckets first, while most slots are still free */
+  size_t sizes[YFIELD_BUCKETS] = { 0 };
+  for (size_t i = 0; i < n; i++) {
+    sizes[YField_hash(fields[i].name, 0) % x->buckets]++;
+  }
+  for (size_t size = n; size > 0; size--) {
+    for (size_t b = 0; b < x->buckets; b++) {
+      if (sizes[b] != size) {
+        continue;
+      }
+      size_t members[YFIELD_SLOTS], m = 0;
+      for (size_t i = 0; i < n; i++) {
+        if (YField_hash(fields[i].name, 0) % x->buckets == b) {
+          members[m++] = i;
+        }
+      }
+      uint32_t seed = 1;
+      for ( ; seed <= YFIELD_SEEDS; seed++) {
+        size_t k = 0;
+        for ( ; k < m; k++) {
+          size_t slot = YField_hash(fields[members[k]].name, seed) & x->mask;
+          if (x->slots[slot]) {
+            break;
+          }
+          x->slots[slot] = members[k] + 1;
+        }
+        if (k == m) {
+          break;
+        }
+        while (k-- > 0) {
+          x->slots[YField_hash(fields[members[k]].name, seed) & x->mask] = 0;
+        }
+      }
+      if (seed > YFIELD_SEEDS) {
+        return YERROR_CERR;
+      }
+      x->seeds[b] = seed;
+    }
+  }
+  return YERROR_NERR;
+}
+
+static const struct YField *YFieldIndex_get(const struct YFieldIndex *x, const char *name)
+{
+  uint32_t seed = x->seeds[YField_hash(name, 0) % x->buckets];
+  uint8_t i = x->slots[YField_hash(name, seed) & x->mask];
+  return i && strcmp(x->fields[i - 1].name, name) == 0 ? &x->fields[i - 1] : NULL;
+}
+
+#define YQUOTE_FIELDS(X) \
+  X(DOUBLE, ask)                               \
+  X(INT   , askSize)                           \
+  X(STRING, averageAnalystRating)              \
+  X(INT   , averageDailyVolume10Day)           \
+  X(INT   , averageDailyVolume3Month)          \
+  X(DOUBLE, bid)                               \
+  X(INT   , bidSize)                           \
+  X(DOUBLE, bookValue)                         \
+  X(STRING, currency)                          \
+  X(STRING, displayName)                       \
+  X(INT   , dividendDate)                      \
+  X(INT   , earningsTimestamp)                 \
+  X(INT   , earningsTimestampEnd)              \
+  X(INT   , earningsTimestampStart)            \
+  X(DOUBLE, epsCurrentYear)                    \
+  X(DOUBLE, epsForward)                        \
+  X(DOUBLE, epsTrailingTwelveMonths)           \
+  X(BOOL  , esgPopulated)                      \
+  X(STRING, exchange)                          \
+  X(INT   , exchangeDataDelayedBy)             \
+  X(STRING, exchangeTimezoneName)              \
+  X(STRING, exchangeTimezoneShortName)         \
+  X(DOUBLE, fiftyDayAverage)                   \
+  X(DOUBLE, fiftyDayAverageChange)             \
+  X(DOUBLE, fiftyDayAverageChangePercent)      \
+  X(DOUBLE, fiftyTwoWeekHigh)                  \
+  X(DOUBLE, fiftyTwoWeekHighChange)            \
+  X(DOUBLE, fiftyTwoWeekHighChangePercent)     \
+  X(DOUBLE, fiftyTwoWeekLow)                   \
+  X(DOUBLE, fiftyTwoWeekLowChange)             \
+  X(DOUBLE, fiftyTwoWeekLowChangePercent)      \
+  X(STRING, fiftyTwoWeekRange)                 \
+  X(STRING, financialCurrency)                 \
+  X(INT   , firstTradeDateMilliseconds)        \
+  X(DOUBLE, forwardPE)                         \
+  X(STRING, fullExchangeName)                  \
+  X(INT   , gmtOffSetMilliseconds)             \
+  X(STRING, language)                          \
+  X(STRING, longName)                          \
+  X(STRING, market)                            \
+  X(INT   , marketCap)                         \
+  X(STRING, marketState)                       \
+  X(DOUBLE, postMarketChange)                  \
+  X(DOUBLE, postMarketChangePercent)           \
+  X(DOUBLE, postMarketPrice)                   \
+  X(INT   , postMarketTime)                    \
+  X(DOUBLE, preMarketChange)                   \
+  X(DOUBLE, preMarketChangePercent)            \
+  X(DOUBLE, preMarketPrice)                    \
+  X(INT   , preMarketTime)                     \
+  X(DOUBLE, priceEpsCurrentYear)               \
+  X(INT   , priceHint)                         \
+  X(DOUBLE, priceToBook)                       \
+  X(STRING, quoteSourceName)                   \
+  X(STRING, quoteType)                         \
+  X(STRING, region)                            \
+  X(DOUBLE, regularMarketChange)               \
+  X(DOUBLE, regularMarketChangePercent)        \
+  X(DOUBLE, regularMarketDayHigh)              \
+  X(DOUBLE, regularMarketDayLow)               \
+  X(STRING, regularMarketDayRange)             \
+  X(DOUBLE, regularMarketOpen)                 \
+  X(DOUBLE, regularMarketPreviousClose)        \
+  X(DOUBLE, regularMarketPrice)                \
+  X(INT   , regularMarketTime)                 \
+  X(INT   , regularMarketVolume)               \
+  X(INT   , sharesOutstanding)                 \
+  X(STRING, shortName)                         \
+  X(INT   , sourceInterval)                    \
+  X(STRING, symbol)                            \
+  X(BOOL  , tradeable)                         \
+  X(DOUBLE, trailingAnnualDividendRate)        \
+  X(DOUBLE, trailingAnnualDividendYield)       \
+  X(DOUBLE, trailingPE)                        \
+  X(BOOL  , triggerable)                       \
+  X(DOUBLE, twoHundredDayAverage)              \
+  X(DOUBLE, twoHundredDayAverageChange)        \
+  X(DOUBLE, twoHundredDayAverageChangePercent) \
+                                               \
+  /* QuoteType.CRYPTOCURRENCY */               \
+  X(INT   , circulatingSupply)                 \
+  X(STRING, fromCurrency)                      \
+  X(STRING, lastMarket)                        \
+  X(INT   , startDate)                         \
+  X(STRING, toCurrency)                        \
+  X(INT   , volume24Hr)                        \
+  X(INT   , volumeAllCurrencies)               \
+                                               \
+  /* QuoteType.ETF */                          \
+  X(DOUBLE, trailingThreeMonthNavReturns)      \
+  X(DOUBLE, trailingThreeMonthReturns)         \
+  X(DOUBLE, ytdReturn)                         \
+                                               \
+  /* QuoteType.OPTION */                       \
+  X(STRING, customPriceAlertConfidence)        \
+  X(INT   , expireDate)                        \
+  X(STRING, expireIsoDate)                     \
+  X(INT   , openInterest)                      \
+  X(DOUBLE, strike)                            \
+  X(STRING, underlyingSymbol)
+
+#define YQUOTE_FIELD(t, n) YFIELD(struct YQuote, t, n)
+static const struct YField yquote_fields[] = { YQUOTE_FIELDS(YQUOTE_FIELD) };
+#undef YQUOTE_FIELD
+
+static struct YFieldIndex yquote_index;
+
+#define YASSETPROFILE_FIELDS(X)        \
+  X(STRING, address1)                  \
+  X(STRING, address2)                  \
+  X(STRING, address3)                  \
+  X(STRING, city)                      \
+  X(STRING, country)                   \
+  X(INT   , fullTimeEmployees)         \
+  X(STRING, industry)                  \
+  X(STRING, longBusinessSummary)       \
+  X(STRING, phone)                     \
+  X(STRING, sector)                    \
+  X(STRING, state)                     \
+  X(STRING, website)                   \
+  X(STRING, zip)                       \
+  X(INT   , auditRisk)                 \
+  X(INT   , boardRisk)                 \
+  X(INT   , compensationAsOfEpochDate) \
+  X(INT   , compensationRisk)          \
+  X(INT   , governanceEpochDate)       \
+  X(INT   , overallRisk)               \
+  X(INT   , shareHolderRightsRisk)
+
+#define YCOMPANYOFFICER_FIELDS(X) \
+  X(INT   , age)                  \
+  X(INT   , exercisedValue)       \
+  X(INT   , fiscalYear)           \
+  X(STRING, name)                 \
+  X(STRING, title)                \
+  X(INT   , totalPay)             \
+  X(INT   , unexercisedValue)     \
+  X(INT   , yearBorn)
+
+#define YDEFAULTKEYSTATISTICS_FIELDS(X)   \
+  X(DOUBLE, annualHoldingsTurnover)       \
+  X(DOUBLE, annualReportExpenseRatio)     \
+  X(DOUBLE, beta)                         \
+  X(DOUBLE, beta3Year)                    \
+  X(DOUBLE, bookValue)                    \
+  X(STRING, category)                     \
+  X(INT   , dateShortInterest)            \
+  X(DOUBLE, earningsQuarterlyGrowth)      \
+  X(DOUBLE, enterpriseToEbitda)           \
+  X(DOUBLE, enterpriseToRevenue)          \
+  X(INT   , enterpriseValue)              \
+  X(DOUBLE, fiveYearAverageReturn)        \
+  X(INT   , floatShares)                  \
+  X(DOUBLE, forwardEps)                   \
+  X(DOUBLE, forwardPE)                    \
+  X(STRING, fundFamily)                   \
+  X(INT   , fundInceptionDate)            \
+  X(DOUBLE, heldPercentInsiders)          \
+  X(DOUBLE, heldPercentInstitutions)      \
+  X(INT   , impliedSharesOutstanding)     \
+  X(DOUBLE, lastCapGain)                  \
+  X(INT   , lastDividendDate)             \
+  X(DOUBLE, lastDividendValue)            \
+  X(INT   , lastFiscalYearEnd)            \
+  X(INT   , lastSplitDate)                \
+  X(STRING, lastSplitFactor)              \
+  X(STRING, legalType)                    \
+  X(INT   , morningStarOverallRating)     \
+  X(INT   , morningStarRiskRating)        \
+  X(INT   , mostRecentQuarter)            \
+  X(INT   , netIncomeToCommon)            \
+  X(INT   , nextFiscalYearEnd)            \
+  X(DOUBLE, pegRatio)                     \
+  X(INT   , priceHint)                    \
+  X(DOUBLE, priceToBook)                  \
+  X(DOUBLE, priceToSalesTrailing12Months) \
+  X(DOUBLE, profitMargins)                \
+  X(DOUBLE, revenueQuarterlyGrowth)       \
+  X(DOUBLE, SandP52WeekChange)            \
+  X(INT   , sharesOutstanding)            \
+  X(DOUBLE, sharesPercentSharesOut)       \
+  X(INT   , sharesShort)                  \
+  X(INT   , sharesShortPreviousMonthDate) \
+  X(INT   , sharesShortPriorMonth)        \
+  X(DOUBLE, shortPercentOfFloat)          \
+  X(DOUBLE, shortRatio)                   \
+  X(DOUBLE, threeYearAverageReturn)       \
+  X(INT   , totalAssets)                  \
+  X(DOUBLE, trailingEps)                  \
+  X(DOUBLE, yield)                        \
+  X(DOUBLE, ytdReturn)
+
+#define YFINANCIALDATA_FIELDS(X)     \
+  X(DOUBLE, currentPrice)            \
+  X(DOUBLE, currentRatio)            \
+  X(DOUBLE, debtToEquity)            \
+  X(DOUBLE, earningsGrowth)          \
+  X(INT   , ebitda)                  \
+  X(DOUBLE, ebitdaMargins)           \
+  X(STRING, financialCurrency)       \
+  X(INT   , freeCashflow)            \
+  X(DOUBLE, grossMargins)            \
+  X(INT   , grossProfits)            \
+  X(INT   , numberOfAnalystOpinions) \
+  X(INT   , operatingCashflow)       \
+  X(DOUBLE, operatingMargins)        \
+  X(DOUBLE, profitMargins)           \
+  X(DOUBLE, quickRatio)              \
+  X(STRING, recommendationKey)       \
+  X(DOUBLE, recommendationMean)      \
+  X(DOUBLE, returnOnAssets)          \
+  X(DOUBLE, returnOnEquity)          \
+  X(DOUBLE, revenueGrowth)           \
+  X(DOUBLE, revenuePerShare)         \
+  X(DOUBLE, targetHighPrice)         \
+  X(DOUBLE, targetLowPrice)          \
+  X(DOUBLE, targetMeanPrice)         \
+  X(DOUBLE, targetMedianPrice)       \
+  X(INT   , totalCash)               \
+  X(DOUBLE, totalCashPerShare)       \
+  X(INT   , totalDebt)               \
+  X(INT   , totalRevenue)
+
+#define YASSETPROFILE_FIELD(t, n) YFIELD(struct AssetProfile, t, n)
+static const struct YField yassetProfile_fields[] = { YASSETPROFILE_FIELDS(YASSETPROFILE_FIELD) };
+#undef YASSETPROFILE_FIELD
+
+#define YCOMPANYOFFICER_FIELD(t, n) YFIELD(struct CompanyOfficer, t, n)
+static const struct YField ycompanyOfficer_fields[] = { YCOMPANYOFFICER_FIELDS(YCOMPANYOFFICER_FIELD) };
+#undef YCOMPANYOFFICER_FIELD
+
+#define YDEFAULTKEYSTATISTICS_FIELD(t, n) YFIELD(struct DefaultKeyStatistics, t, n)
+static const struct YField ydefaultKeyStatistics_fields[] = {
+  YDEFAULTKEYSTATISTICS_FIELDS(YDEFAULTKEYSTATISTICS_FIELD)
+  /* Not a valid identifier */
+  { "52WeekChange", YFIELD_DOUBLE, offsetof(struct DefaultKeyStatistics, fiftyTwoWeekChange), sizeof(double) },
+};
+#undef YDEFAULTKEYSTATISTICS_FIELD
+
+#define YFINANCIALDATA_FIELD(t, n) YFIELD(struct FinancialData, t, n)
+static const struct YField yfinancialData_fields[] = { YFINANCIALDATA_FIELDS(YFINANCIALDATA_FIELD) };
+#undef YFINANCIALDATA_FIELD
+
+static struct YFieldIndex yassetProfile_index;
+static struct YFieldIndex ycompanyOfficer_index;
+static struct YFieldIndex ydefaultKeyStatistics_index;
+static struct YFieldIndex yfinancialData_index;
+
+/* Decodes the member at the cursor, a plain value or one wrapped in { "raw", "fmt" } */
+static void json_value(JsonReader *r, const struct YField *f, void *p)
+{
+  void *v = (char *) p + f->offset;
+  switch (f->type) {
+  case YFIELD_BOOL:
+    json_bool   (r, "raw", v);
+    break;
+  case YFIELD_INT:
+    json_int    (r, "raw", v);
+    break;
+  case YFIELD_DOUBLE:
+    json_double (r, "raw", v);
+    break;
+  case YFIELD_STRING:
+    if (json_cstring(r, "fmt", v, f->size) == 0) {
+      json_cstring(r, "longFmt", v, f->size);
+    }
+    break;
+  }
+}
+
+/**
+ * Walks the members of the object at the cursor once, in document order,
+ * decoding those the index knows.
+ */
+static void json_fields(JsonReader *r, const struct YFieldIndex *x, void *p)
+{
+  for (int i = 0, n = json_reader_count_members(r); i < n; i++) {
+    if (json_reader_read_element(r, i)) {
+      const struct YField *f = YFieldIndex_get(x, json_reader_get_member_name(r));
+      if (f) {
+        json_value(r, f, p);
+      }
+    }
+    json_reader_end_element(r);
+  }
 }
 
 static void json_companyOfficer(JsonReader *r, const char *n _U_, void *v)
 {
-  struct CompanyOfficer *p = (struct CompanyOfficer *) v;
-  json_int    (r, "age", &p->age);
-  json_int    (r, "exercisedValue", &p->exercisedValue);
-  json_int    (r, "fiscalYear", &p->fiscalYear);
-  json_string (r, "name", p->name);
-  json_string (r, "title", p->title);
-  json_int    (r, "totalPay", &p->totalPay);
-  json_int    (r, "unexercisedValue", &p->unexercisedValue);
-  json_int    (r, "yearBorn", &p->yearBorn);
+  memset(v, 0, sizeof(struct CompanyOfficer));
+  json_fields(r, &ycompanyOfficer_index, v);
 }
 
 static void json_assetProfile(JsonReader *r, struct AssetProfile *p)
 {
   if (json_reader_read_member(r, "assetProfile")) {
-    json_string (r, "address1", p->address1);
-    json_string (r, "address2", p->address2);
-    json_string (r, "address3", p->address3);
-    json_string (r, "city", p->city);
-    json_string (r, "country", p->country);
-    json_int    (r, "fullTimeEmployees", &p->fullTimeEmployees);
-    json_string (r, "industry", p->industry);
-    json_text   (r, "longBusinessSummary", p->longBusinessSummary);
-    json_string (r, "phone", p->phone);
-    json_string (r, "sector", p->sector);
-    json_string (r, "state", p->state);
-    json_string (r, "website", p->website);
-    json_string (r, "zip", p->zip);
-
+    memset(p, 0, sizeof(struct AssetProfile));
+    json_fields (r, &yassetProfile_index, p);
     json_array  (r, "companyOfficers", p->companyOfficers, 0, COMPANY_OFFICERS,
                  sizeof(struct CompanyOfficer), json_companyOfficer);
-
-    json_int    (r, "auditRisk", &p->auditRisk);
-    json_int    (r, "boardRisk", &p->boardRisk);
-    json_int    (r, "compensationAsOfEpochDate", &p->compensationAsOfEpochDate);
-    json_int    (r, "compensationRisk", &p->compensationRisk);
-    json_int    (r, "governanceEpochDate", &p->governanceEpochDate);
-    json_int    (r, "overallRisk", &p->overallRisk);
-    json_int    (r, "shareHolderRightsRisk", &p->shareHolderRightsRisk);
   }
   json_reader_end_member(r);
 }
@@ -387,58 +895,8 @@ static void json_calendarEvents(JsonReader *r, struct CalendarEvents *p)
 static void json_defaultKeyStatistics(JsonReader *r, struct DefaultKeyStatistics *p)
 {
   if (json_reader_read_member(r, "defaultKeyStatistics")) {
-    json_double (r, "annualHoldingsTurnover", &p->annualHoldingsTurnover);
-    json_double (r, "annualReportExpenseRatio", &p->annualReportExpenseRatio);
-    json_double (r, "beta", &p->beta);
-    json_double (r, "beta3Year", &p->beta3Year);
-    json_double (r, "bookValue", &p->bookValue);
-    json_string (r, "category", p->category);
-    json_int    (r, "dateShortInterest", &p->dateShortInterest);
-    json_double (r, "earningsQuarterlyGrowth", &p->earningsQuarterlyGrowth);
-    json_double (r, "enterpriseToEbitda", &p->enterpriseToEbitda);
-    json_double (r, "enterpriseToRevenue", &p->enterpriseToRevenue);
-    json_int    (r, "enterpriseValue", &p->enterpriseValue);
-    json_double (r, "52WeekChange", &p->fiftyTwoWeekChange);
-    json_double (r, "fiveYearAverageReturn", &p->fiveYearAverageReturn);
-    json_int    (r, "floatShares", &p->floatShares);
-    json_double (r, "forwardEps", &p->forwardEps);
-    json_double (r, "forwardPE", &p->forwardPE);
-    json_string (r, "fundFamily", p->fundFamily);
-    json_int    (r, "fundInceptionDate", &p->fundInceptionDate);
-    json_double (r, "heldPercentInsiders", &p->heldPercentInsiders);
-    json_double (r, "heldPercentInstitutions", &p->heldPercentInstitutions);
-    json_int    (r, "impliedSharesOutstanding", &p->impliedSharesOutstanding);
-    json_double (r, "lastCapGain", &p->lastCapGain);
-    json_int    (r, "lastDividendDate", &p->lastDividendDate);
-    json_double (r, "lastDividendValue", &p->lastDividendValue);
-    json_int    (r, "lastFiscalYearEnd", &p->lastFiscalYearEnd);
-    json_int    (r, "lastSplitDate", &p->lastSplitDate);
-    json_string (r, "lastSplitFactor", p->lastSplitFactor);
-    json_string (r, "legalType", p->legalType);
-    json_int    (r, "morningStarOverallRating", &p->morningStarOverallRating);
-    json_int    (r, "morningStarRiskRating", &p->morningStarRiskRating);
-    json_int    (r, "mostRecentQuarter", &p->mostRecentQuarter);
-    json_int    (r, "netIncomeToCommon", &p->netIncomeToCommon);
-    json_int    (r, "nextFiscalYearEnd", &p->nextFiscalYearEnd);
-    json_double (r, "pegRatio", &p->pegRatio);
-    json_int    (r, "priceHint", &p->priceHint);
-    json_double (r, "priceToBook", &p->priceToBook);
-    json_double (r, "priceToSalesTrailing12Months", &p->priceToSalesTrailing12Months);
-    json_double (r, "profitMargins", &p->profitMargins);
-    json_double (r, "revenueQuarterlyGrowth", &p->revenueQuarterlyGrowth);
-    json_double (r, "SandP52WeekChange", &p->SandP52WeekChange);
-    json_int    (r, "sharesOutstanding", &p->sharesOutstanding);
-    json_double (r, "sharesPercentSharesOut", &p->sharesPercentSharesOut);
-    json_int    (r, "sharesShort", &p->sharesShort);
-    json_int    (r, "sharesShortPreviousMonthDate", &p->sharesShortPreviousMonthDate);
-    json_int    (r, "sharesShortPriorMonth", &p->sharesShortPriorMonth);
-    json_double (r, "shortPercentOfFloat", &p->shortPercentOfFloat);
-    json_double (r, "shortRatio", &p->shortRatio);
-    json_double (r, "threeYearAverageReturn", &p->threeYearAverageReturn);
-    json_int    (r, "totalAssets", &p->totalAssets);
-    json_double (r, "trailingEps", &p->trailingEps);
-    json_double (r, "yield", &p->yield);
-    json_double (r, "ytdReturn", &p->ytdReturn);
+    memset(p, 0, sizeof(struct DefaultKeyStatistics));
+    json_fields (r, &ydefaultKeyStatistics_index, p);
   }
   json_reader_end_member(r);
 }
@@ -502,35 +960,8 @@ static void json_earningsTrend(JsonReader *r, const char *n _U_, void *v)
 static void json_financialData(JsonReader *r, struct FinancialData *p)
 {
   if (json_reader_read_member(r, "financialData")) {
-    json_double (r, "currentPrice", &p->currentPrice);
-    json_double (r, "currentRatio", &p->currentRatio);
-    json_double (r, "debtToEquity", &p->debtToEquity);
-    json_double (r, "earningsGrowth", &p->earningsGrowth);
-    json_int    (r, "ebitda", &p->ebitda);
-    json_double (r, "ebitdaMargins", &p->ebitdaMargins);
-    json_string (r, "financialCurrency", p->financialCurrency);
-    json_int    (r, "freeCashflow", &p->freeCashflow);
-    json_double (r, "grossMargins", &p->grossMargins);
-    json_int    (r, "grossProfits", &p->grossProfits);
-    json_int    (r, "numberOfAnalystOpinions", &p->numberOfAnalystOpinions);
-    json_int    (r, "operatingCashflow", &p->operatingCashflow);
-    json_double (r, "operatingMargins", &p->operatingMargins);
-    json_double (r, "profitMargins", &p->profitMargins);
-    json_double (r, "quickRatio", &p->quickRatio);
-    json_string (r, "recommendationKey", p->recommendationKey);
-    json_double (r, "recommendationMean", &p->recommendationMean);
-    json_double (r, "returnOnAssets", &p->returnOnAssets);
-    json_double (r, "returnOnEquity", &p->returnOnEquity);
-    json_double (r, "revenueGrowth", &p->revenueGrowth);
-    json_double (r, "revenuePerShare", &p->revenuePerShare);
-    json_double (r, "targetHighPrice", &p->targetHighPrice);
-    json_double (r, "targetLowPrice", &p->targetLowPrice);
-    json_double (r, "targetMeanPrice", &p->targetMeanPrice);
-    json_double (r, "targetMedianPrice", &p->targetMedianPrice);
-    json_int    (r, "totalCash", &p->totalCash);
-    json_double (r, "totalCashPerShare", &p->totalCashPerShare);
-    json_int    (r, "totalDebt", &p->totalDebt);
-    json_int    (r, "totalRevenue", &p->totalRevenue);
+    memset(p, 0, sizeof(struct FinancialData));
+    json_fields (r, &yfinancialData_index, p);
   }
   json_reader_end_member(r);
 }
@@ -582,198 +1013,116 @@ static struct YQuoteSummary *json_quoteSummary(JsonReader *r, const char *s)
   return q;
 }
 
-static struct YChart *json_chart(JsonReader *r, const char *s)
-{
-  struct YChart *c = ght_get(yql_charts, s, sizeof(struct YChart));
-
-  if (json_reader_read_member(r, "meta")) {
-    json_double (r, "chartPreviousClose", &c->chartPreviousClose);
-    json_double (r, "regularMarketPrice", &c->regularMarketPrice);
-    json_string (r, "symbol", c->symbol);
-    assert(strncmp(c->symbol, s, YSTRING_LENGTH) == 0);
-  }
-  json_reader_end_member(r);
-
-  c->count = json_int_rarray    (r, "timestamp", c->timestamp, YARRAY_LENGTH);
-
-  if (json_reader_read_member(r, "indicators")) {
-    if (json_reader_read_member(r, "adjclose")) {
-      if (json_reader_is_array(r)) {
-        for (int i = 0; i < json_reader_count_elements(r); i++) {
-          if (json_reader_read_element(r, i)) {
-            assert(json_double_rarray (r, "adjclose", c->adjclose, YARRAY_LENGTH) == c->count);
-          }
-          json_reader_end_element(r);
-        }
-      }
-    }
-    json_reader_end_member(r);
-
-    if (json_reader_read_member(r, "quote")) {
-      if (json_reader_is_array(r)) {
-        for (int i = 0; i < json_reader_count_elements(r); i++) {
-          if (json_reader_read_element(r, i)) {
-            assert(json_double_rarray (r, "close", c->close, YARRAY_LENGTH)       == c->count);
-            assert(json_double_rarray (r, "high", c->high, YARRAY_LENGTH)         == c->count);
-            assert(json_double_rarray (r, "low", c->low, YARRAY_LENGTH)           == c->count);
-            assert(json_double_rarray (r, "open", c->open, YARRAY_LENGTH)         == c->count);
-            assert(json_int_rarray    (r, "volume", c->volume, YARRAY_LENGTH)     == c->count);
-          }
-          json_reader_end_element(r);
-        }
-      }
-    }
-    json_reader_end_member(r);
-  }
-  json_reader_end_member(r);
-
-  return c;
-}
-
-static void json_option(JsonReader *r, struct YOption *p)
+static void YChart_set(struct YChart *c, size_t i, const struct YChart *d, size_t j)
 {
-  json_double (r, "ask", &p->ask);
-  json_double (r, "bid", &p->bid);
-  json_double (r, "change", &p->change);
-  json_string (r, "contractSize", p->contractSize);
-  json_string (r, "contractSymbol", p->contractSymbol);
-  json_string (r, "currency", p->currency);
-  json_int    (r, "expiration", &p->expiration);
-  json_double (r, "impliedVolatility", &p->impliedVolatility);
-  json_bool   (r, "inTheMoney", &p->inTheMoney);
-  json_double (r, "lastPrice", &p->lastPrice);
-  json_int    (r, "lastTradeDate", &p->lastTradeDate);
-  json_int    (r, "openInterest", &p->openInterest);
-  json_double (r, "percentChange", &p->percentChange);
-  json_double (r, "strike", &p->strike);
-  json_int    (r, "volume", &p->volume);
+  c->timestamp[i] = d->timestamp[j];
+  c->adjclose[i]  = d->adjclose[j];
+  c->close[i]     = d->close[j];
+  c->high[i]      = d->high[j];
+  c->low[i]       = d->low[j];
+  c->open[i]      = d->open[j];
+  c->volume[i]    = d->volume[j];
 }
 
-static size_t json_options(JsonReader *r, const char *n, struct YOption *p,
-                           const double ks[], size_t kn)
+/**
+ * Merges the bars of an incremental response into the cached chart: a bar
+ * with a cached timestamp (the still open one) is replaced, newer bars are
+ * appended, shifting out the oldest once YARRAY_LENGTH bars are held.
+ */
+static void YChart_merge(struct YChart *c, const struct YChart *d)
 {
-  size_t ki = 0;
-  if (json_reader_read_member(r, n)) {
-    if (json_reader_is_array(r)) {
-      for (int i = 0; i < json_reader_count_elements(r); i++) {
-        if (json_reader_read_element(r, i)) {
-          double k = 0.0d;
-          json_double (r, "strike", &k);
-          for ( ; ki < kn && ks[ki] <= k; ki++, p++) {
-            if (ks[ki] == k) {
-              json_option(r, p);
-            }
-          }
+  c->regularMarketPrice = d->regularMarketPrice;
+  for (size_t j = 0; j < d->count; j++) {
+    size_t i = c->count;
+    while (i > 0 && c->timestamp[i - 1] > d->timestamp[j]) {
+      i--;
+    }
+    if (i > 0 && c->timestamp[i - 1] == d->timestamp[j]) {
+      YChart_set(c, i - 1, d, j);
+    } else if (i == c->count) {
+      if (c->count == YARRAY_LENGTH) {
+        for (size_t k = 1; k < c->count; k++) {
+          YChart_set(c, k - 1, c, k);
         }
-        json_reader_end_element(r);
+        c->count--;
       }
+      YChart_set(c, c->count++, d, j);
     }
   }
-  json_reader_end_member(r);
-  return ki;
 }
 
-static void json_straddle(JsonReader *r, struct YOption *p, struct YOption *q)
+static struct YChart *json_spark(JsonReader *r, const char *s _U_)
 {
-  if (json_reader_read_member(r, "call")) {
-    json_option(r, p);
+  YString symbol;
+  json_string (r, "symbol", symbol);
+  struct YChart *c = ght_get(yql_charts, symbol, sizeof(struct YChart));
+  if (!c) {
+    return NULL;
   }
-  json_reader_end_member(r);
 
-  if (json_reader_read_member(r, "put")) {
-    json_option(r, q);
+  /* Never flatten a full chart: parse aside and only carry the price over */
+  struct YChart spark = { .count = 0 };
+  struct YChart *full = c->count && !c->closeOnly ? c : NULL;
+  if (full) {
+    c = &spark;
   }
-  json_reader_end_member(r);
-}
 
-static size_t json_straddles(JsonReader *r, struct YOption *p, struct YOption *q,
-                             const double ks[], size_t kn)
-{
-  size_t ki = 0;
-  if (json_reader_read_member(r, "straddles")) {
-    if (json_reader_is_array(r)) {
-      for (int i = 0; i < json_reader_count_elements(r); i++) {
-        if (json_reader_read_element(r, i)) {
-          double k = 0.0d;
-          json_double (r, "strike", &k);
-          for ( ; ki < kn && ks[ki] <= k; ki++, p++, q++) {
-            if (ks[ki] == k) {
-              json_straddle(r, p, q);
-            }
-          }
+  if (json_reader_read_member(r, "response")) {
+    if (json_reader_is_array(r) && json_reader_count_elements(r) > 0) {
+      if (json_reader_read_element(r, 0)) {
+        if (json_reader_read_member(r, "meta")) {
+          json_double (r, "chartPreviousClose", &c->chartPreviousClose);
+          json_double (r, "regularMarketPrice", &c->regularMarketPrice);
         }
-        json_reader_end_element(r);
-      }
-    }
-  }
-  json_reader_end_member(r);
-  return ki;
-}
-
-static struct YOptionChain *json_optionChain(JsonReader *r, const char *s)
-{
-  struct YOptionChain *o = ght_get(yql_optionChains, s, sizeof(struct YOptionChain));
-
-  json_string (r, "underlyingSymbol", o->underlyingSymbol);
-  assert(strncmp(o->underlyingSymbol, s, YSTRING_LENGTH) == 0);
+        json_reader_end_member(r);
+        YString_copy(c->symbol, symbol);
 
-  struct YQuote *q = ght_get(yql_quotes, o->underlyingSymbol, sizeof(struct YQuote));
-  /* if (json_reader_read_member(r, "quote")) { */
-  /*   q = json_quote(r, o->underlyingSymbol); */
-  /* } */
-  /* json_reader_end_member(r); */
+        c->count = json_int_rarray    (r, "timestamp", c->timestamp, YARRAY_LENGTH);
 
-  json_int_larray    (r, "expirationDates", o->expirationDates, 0, EXPIRATION_DATES);
-
-  int strikeRange(JsonReader *r, int *a, int *b, size_t n)
-  {
-    *a = *b = 0;
-    if (json_reader_read_member(r, "strikes")) {
-      if (json_reader_is_array(r)) {
-        for (int i = 0, k = json_reader_count_elements(r); i < k; i++) {
-          if (json_reader_read_element(r, i)) {
-            double strike = 0.0d;
-            json_double (r, "strike", &strike);
-            if (strike > q->regularMarketPrice) {
-              *a = i - n / 2, *b = i + n / 2;
-              if (*a < 0) {
-                *b = min(*b + (0 - *a), k), *a = max(0, *a);
-              }
-              if (*b > k) {
-                *a = max(*a - (*b - k), 0), *b = min(*b, k);
+        if (json_reader_read_member(r, "indicators")) {
+          size_t n = 0;
+          if (json_reader_read_member(r, "quote")) {
+            if (json_reader_is_array(r) && json_reader_count_elements(r) > 0) {
+              if (json_reader_read_element(r, 0)) {
+                assert(json_double_rarray (r, "close", c->close, YARRAY_LENGTH) == c->count);
               }
               json_reader_end_element(r);
-              break;
             }
           }
-          json_reader_end_element(r);
-        }
-      }
-    }
-    json_reader_end_member(r);
-    return *a;
-  }
-  int a = 0, b = 0;
-  strikeRange(r, &a, &b, YARRAY_LENGTH);
-  o->count = json_double_larray (r, "strikes", o->strikes, a, YARRAY_LENGTH);
+          json_reader_end_member(r);
 
-  if (json_reader_read_member(r, "options")) {
-    if (json_reader_is_array(r)) {
-      for (int i = 0; i < json_reader_count_elements(r); i++) {
-        if (json_reader_read_element(r, i)) {
-          json_int    (r, "expirationDate", &o->expirationDate);
-          json_bool   (r, "hasMiniOptions", &o->hasMiniOptions);
-          json_options(r, "calls", o->calls, o->strikes, o->count);
-          json_options(r, "puts", o->puts, o->strikes, o->count);
-          json_straddles(r, o->calls, o->puts, o->strikes, o->count);
+          if (json_reader_read_member(r, "adjclose")) {
+            if (json_reader_is_array(r) && json_reader_count_elements(r) > 0) {
+              if (json_reader_read_element(r, 0)) {
+                n = json_double_rarray (r, "adjclose", c->adjclose, YARRAY_LENGTH);
+              }
+              json_reader_end_element(r);
+            }
+          }
+          json_reader_end_member(r);
+
+          /* Spark carries closes only: flatten the bar around them */
+          for (size_t i = 0; i < c->count; i++) {
+            c->open[i] = c->high[i] = c->low[i] = c->close[i];
+            c->volume[i] = 0;
+            if (n != c->count) {
+              c->adjclose[i] = c->close[i];
+            }
+          }
         }
-        json_reader_end_element(r);
+        json_reader_end_member(r);
+        c->closeOnly = true;
       }
+      json_reader_end_element(r);
     }
   }
   json_reader_end_member(r);
 
-  return o;
+  if (full) {
+    full->regularMarketPrice = spark.regularMarketPrice;
+    return full;
+  }
+  return c;
 }
 
 static int json_read(JsonNode *node, const char *symbol)
@@ -815,14 +1164,10 @@ static int json_read(JsonNode *node, const char *symbol)
           }
           for (int i = 0; i < json_reader_count_elements(reader); i++) {
             if (json_reader_read_element(reader, i)) {
-              if (strcmp(response, "quoteResponse") == 0) {
-                json_quote(reader, symbol);
-              } else if (strcmp(response, "quoteSummary") == 0) {
+              if (strcmp(response, "quoteSummary") == 0) {
                 json_quoteSummary(reader, symbol);
-              } else if (strcmp(response, "chart") == 0) {
-                json_chart(reader, symbol);
-              } else if (strcmp(response, "optionChain") == 0) {
-                json_optionChain(reader, symbol);
+              } else if (strcmp(response, "spark") == 0) {
+                json_spark(reader, symbol);
               } else {
                 log_warn(logger, "YError: Unknown response=%s\n", response);
               }
@@ -840,7 +1185,7 @@ static int json_read(JsonNode *node, const char *symbol)
   return YERROR_NERR;
 }
 
-static int json_parse(struct JsonBuffer *buffer, const char *symbol)
+static int json_load(struct HttpBuffer *buffer, const char *symbol)
 {
   JsonParser *parser = json_parser_new();
   GError *error = NULL;
@@ -859,71 +1204,1335 @@ static int json_parse(struct JsonBuffer *buffer, const char *symbol)
   return status;
 }
 
-int yql_init()
-{
-  log_open(&logger, LOG_FILENAME);
+/**
+ * Streaming decoding of the quote, chart and options responses.  jstream
+ * tokenizes the body as it arrives and json_event() tracks the path of
+ * containers, so each value is stored straight into its field without a
+ * document tree or a whole body ever being held.  Each element of result
+ * is decoded into scratch and committed to the cache when it closes, so an
+ * interrupted transfer never leaves a half-updated entry.  The response
+ * name, the first member, picks the decoder; responses without one are
+ * buffered and go through json_load().
+ */
+#define YJSON_DEPTH       10  /*< tracked levels, deeper values are skipped */
+#define YJSON_KEY_LENGTH  63
+#define YJSON_PATH_LENGTH 255
+#define YJSON_ELEMENT     4   /*< root, response, result, element */
 
-  yql_quotes = g_hash_table_new_full(g_str_hash, g_str_equal, free, free);
-  yql_quoteSummaries = g_hash_table_new_full(g_str_hash, g_str_equal, free, free);
-  yql_charts = g_hash_table_new_full(g_str_hash, g_str_equal, free, free);
-  yql_optionChains = g_hash_table_new_full(g_str_hash, g_str_equal, free, free);
-  yql_headlines = g_hash_table_new_full(g_str_hash, g_str_equal, free, YHeadline_destroy);
+enum YJsonMode
+{
+  YJSON_PENDING, /*< response name not seen yet */
+  YJSON_STREAM,
+  YJSON_BUFFER,
+};
 
-  CURLcode code = curl_global_init(CURL_GLOBAL_ALL);
-  if (code != CURLE_OK) {
-    log_error(logger, "curl_global_init(CURL_GLOBAL_ALL): %s\n", curl_easy_strerror(code));
-    return YERROR_CURL;
-  }
+struct YJsonFrame
+{
+  bool   array;
+  size_t count;  /*< elements so far, arrays only */
+  size_t end;    /*< length of path including this level */
+};
 
-  return YERROR_NERR;
-}
+struct YJson;
 
-void yql_free()
+/**
+ * value receives, for every scalar and every container end inside a result
+ * element, the path of its container relative to the element, with "*"
+ * naming array elements, and its member name (NULL within an array).
+ */
+struct YDecoder
 {
-  xmlCleanupParser();
-  curl_global_cleanup();
+  const char *response;
+  size_t      size; /*< scratch */
+  void (*value)(struct YJson *, enum JStreamEvent, const char *, const char *, const char *);
+  void (*close)(struct YJson *);
+  void (*discard)(struct YJson *);
+};
 
-  g_hash_table_destroy(yql_headlines);      yql_headlines = NULL;
-  g_hash_table_destroy(yql_optionChains);   yql_optionChains = NULL;
-  g_hash_table_destroy(yql_charts);         yql_charts = NULL;
-  g_hash_table_destroy(yql_quoteSummaries); yql_quoteSummaries = NULL;
-  g_hash_table_destroy(yql_quotes);         yql_quotes = NULL;
+struct YJson
+{
+  struct JStream  stream;
+  enum YJsonMode  mode;
+  const struct YDecoder *decoder;
+  struct YArena  *arena;   /*< of the request, holds this and the scratch */
+  const char     *symbol;
+  bool            merge;
+  bool            failed;
+  int             depth;
+  struct YJsonFrame frames[YJSON_DEPTH];
+  char            path[YJSON_PATH_LENGTH + 1];
+  char            key[YJSON_KEY_LENGTH + 1];
+  YString         response;
+  bool            result;  /*< within the result array */
+  bool            error;   /*< error member is not null */
+  bool            empty;   /*< result is an empty array */
+  YString         code;
+  YText           description;
+  void           *scratch;
+};
 
-  log_close(logger);                        logger = NULL;
+static size_t json_index(const struct YJson *j)
+{
+  return j->frames[j->depth - 1].count;
 }
 
-static size_t callback(char *p, size_t size, size_t nmemb, void *user)
+static void json_set(enum YFieldType type, void *v, size_t size, enum JStreamEvent e, const char *s)
 {
-  size_t nsize = size * nmemb;
-  struct JsonBuffer *buffer = (struct JsonBuffer *) user;
-  buffer->data = realloc(buffer->data, buffer->size + nsize + 1);
-  if (!buffer->data) {
-    log_error(logger, "%s:%d: realloc(%zu): %s\n", __FILE__, __LINE__, buffer->size + nsize + 1, strerror(errno));
+  switch (type) {
+  case YFIELD_BOOL:
+    *(bool *) v = e == JSTREAM_TRUE;
+    break;
+  case YFIELD_INT:
+    *(int64_t *) v = e != JSTREAM_NUMBER ? 0L : strpbrk(s, ".eE") ? (int64_t) strtod(s, NULL) : strtoll(s, NULL, 10);
+    break;
+  case YFIELD_DOUBLE:
+    *(double *) v = e == JSTREAM_NUMBER ? strtod(s, NULL) : 0.0d;
+    break;
+  case YFIELD_STRING:
+    strncpy(v, e == JSTREAM_STRING ? s : "", size);
+    ((char *) v)[size - 1] = '\0';
+    break;
+  }
+}
+
+static void json_store(const struct YField *f, void *p, enum JStreamEvent e, const char *s)
+{
+  json_set(f->type, (char *) p + f->offset, f->size, e, s);
+}
+
+/**
+ * Resolves the field a value belongs to, either a member of the element or
+ * the raw (numbers) or fmt and longFmt (strings) member of one wrapped as
+ * { "raw": ..., "fmt": ... }, as quoteSummary does.
+ */
+static const struct YField *json_member(const char *path, const char *name, void *p,
+                                        const struct YFieldIndex *x)
+{
+  if (!name) {
+    return NULL;
+  } else if (!*path) {
+    return YFieldIndex_get(x, name);
+  }
+  const struct YField *f = NULL;
+  if (!strchr(path + 1, '/') && (f = YFieldIndex_get(x, path + 1))) {
+    if (f->type == YFIELD_STRING) {
+      bool fmt = strcmp(name, "fmt") == 0, longFmt = strcmp(name, "longFmt") == 0;
+      return fmt || (longFmt && !*((char *) p + f->offset)) ? f : NULL;
+    }
+    return strcmp(name, "raw") == 0 ? f : NULL;
+  }
+  return NULL;
+}
+
+struct YQuoteScratch
+{
+  struct YQuote q;
+  bool          seen[sizeof(yquote_fields) / sizeof(yquote_fields[0])];
+};
+
+static void json_quote_value(struct YJson *j, enum JStreamEvent e, const char *path, const char *name, const char *s)
+{
+  struct YQuoteScratch *x = j->scratch;
+  const struct YField *f = NULL;
+  if (e < JSTREAM_STRING || !(f = json_member(path, name, &x->q, &yquote_index))) {
+    return;
+  }
+  json_store(f, &x->q, e, s);
+  x->seen[f - yquote_fields] = true;
+}
+
+/**
+ * Commits only the members present in the response, so a request projected
+ * with fields= touches only those members of the cached quote and leaves the
+ * rest as previously fetched.
+ */
+static void json_quote_close(struct YJson *j)
+{
+  struct YQuoteScratch *x = j->scratch;
+  const struct YField *symbol = YFieldIndex_get(&yquote_index, "symbol");
+  struct YQuote *q = NULL;
+  if (x->seen[symbol - yquote_fields] && (q = ght_get(yql_quotes, x->q.symbol, sizeof(struct YQuote)))) {
+    for (size_t i = 0; i < sizeof(yquote_fields) / sizeof(yquote_fields[0]); i++) {
+      if (x->seen[i]) {
+        const struct YField *f = &yquote_fields[i];
+        memcpy((char *) q + f->offset, (char *) &x->q + f->offset, f->size);
+      }
+    }
+  }
+  memset(x, 0, sizeof(struct YQuoteScratch));
+}
+
+#define YCHART_META_FIELDS(X)  \
+  X(DOUBLE, chartPreviousClose) \
+  X(DOUBLE, regularMarketPrice) \
+  X(STRING, symbol)
+
+#define YCHART_FIELD(t, n) YFIELD(struct YChart, t, n)
+static const struct YField ychart_meta[] = { YCHART_META_FIELDS(YCHART_FIELD) };
+#undef YCHART_FIELD
+
+/* Series by path, sized per element; only the last YARRAY_LENGTH values of each are kept */
+#define YCHART_SERIES(path, t, n) { path, YFIELD_##t, offsetof(struct YChart, n), sizeof(((struct YChart *) 0)->n[0]) },
+static const struct YField ychart_series[] = {
+  YCHART_SERIES("/timestamp",                      INT   , timestamp)
+  YCHART_SERIES("/indicators/adjclose/*/adjclose", DOUBLE, adjclose)
+  YCHART_SERIES("/indicators/quote/*/close",       DOUBLE, close)
+  YCHART_SERIES("/indicators/quote/*/high",        DOUBLE, high)
+  YCHART_SERIES("/indicators/quote/*/low",         DOUBLE, low)
+  YCHART_SERIES("/indicators/quote/*/open",        DOUBLE, open)
+  YCHART_SERIES("/indicators/quote/*/volume",      INT   , volume)
+};
+#undef YCHART_SERIES
+
+static struct YFieldIndex ychart_meta_index;
+static struct YFieldIndex ychart_series_index;
+
+/**
+ * Values of a series are stored modulo YARRAY_LENGTH as they arrive; when
+ * it closes, a series longer than that is rotated back into order.
+ */
+static void json_chart_value(struct YJson *j, enum JStreamEvent e, const char *path, const char *name, const char *s)
+{
+  struct YChart *c = j->scratch;
+  const struct YField *f = NULL;
+  if (strcmp(path, "/meta") == 0 && name) {
+    if (e >= JSTREAM_STRING && (f = YFieldIndex_get(&ychart_meta_index, name))) {
+      json_store(f, c, e, s);
+    }
+  } else if (!name && (f = YFieldIndex_get(&ychart_series_index, path))) {
+    size_t size = f->size, n = json_index(j);
+    char *v = (char *) c + f->offset;
+    if (e >= JSTREAM_STRING) {
+      json_set(f->type, v + n % YARRAY_LENGTH * size, size, e, s);
+    } else if (e == JSTREAM_ARRAY_END) {
+      if (n > YARRAY_LENGTH) {
+        char w[YARRAY_LENGTH * sizeof(double)];
+        size_t k = n % YARRAY_LENGTH * size;
+        memcpy(w, v, YARRAY_LENGTH * size);
+        memcpy(v, w + k, YARRAY_LENGTH * size - k);
+        memcpy(v + YARRAY_LENGTH * size - k, w, k);
+      }
+      if (f->offset == offsetof(struct YChart, timestamp)) {
+        c->count = n < YARRAY_LENGTH ? n : YARRAY_LENGTH;
+      }
+    }
+  }
+}
+
+static void json_chart_close(struct YJson *j)
+{
+  struct YChart *d = j->scratch;
+  assert(strncmp(d->symbol, j->symbol, YSTRING_LENGTH) == 0);
+  struct YChart *c = ght_get(yql_charts, j->symbol, sizeof(struct YChart));
+  if (c && j->merge) {
+    YChart_merge(c, d);
+  } else if (c) {
+    memcpy(c, d, sizeof(struct YChart));
+  }
+  memset(d, 0, sizeof(struct YChart));
+}
+
+#define YOPTION_FIELDS(X)  \
+  X(DOUBLE, ask)               \
+  X(DOUBLE, bid)               \
+  X(DOUBLE, change)            \
+  X(STRING, contractSize)      \
+  X(STRING, contractSymbol)    \
+  X(STRING, currency)          \
+  X(INT   , expiration)        \
+  X(DOUBLE, impliedVolatility) \
+  X(BOOL  , inTheMoney)        \
+  X(DOUBLE, lastPrice)         \
+  X(INT   , lastTradeDate)     \
+  X(INT   , openInterest)      \
+  X(DOUBLE, percentChange)     \
+  X(DOUBLE, strike)            \
+  X(INT   , volume)
+
+#define YOPTION_FIELD(t, n) YFIELD(struct YOption, t, n)
+static const struct YField yoption_fields[] = { YOPTION_FIELDS(YOPTION_FIELD) };
+#undef YOPTION_FIELD
+
+static struct YFieldIndex yoption_index;
+
+struct YOptionScratch
+{
+  struct YOptionChain o;
+  struct YOption call;   /*< contract being decoded */
+  struct YOption put;
+  double         strike; /*< of the straddle being decoded */
+  double        *strikes; /*< all strikes listed, the window is cut when they close */
+  size_t         nstrikes;
+  size_t         capacity;
+};
+
+static void json_option(struct YOption *p, enum JStreamEvent e, const char *name, const char *s)
+{
+  const struct YField *f = YFieldIndex_get(&yoption_index, name);
+  if (f) {
+    json_store(f, p, e, s);
+  }
+}
+
+/* Stores a contract at its strike, if within the window kept */
+static void json_option_put(const struct YOptionChain *o, struct YOption *v, struct YOption *p)
+{
+  size_t a = 0, b = o->count;
+  while (a < b) {
+    size_t m = a + (b - a) / 2;
+    if (o->strikes[m] < p->strike) {
+      a = m + 1;
+    } else {
+      b = m;
+    }
+  }
+  if (a < o->count && o->strikes[a] == p->strike) {
+    v[a] = *p;
+  }
+  memset(p, 0, sizeof(struct YOption));
+}
+
+/**
+ * Keeps YARRAY_LENGTH strikes centered on the first one above the last
+ * price of the underlying.
+ */
+static void json_strikes(struct YOptionScratch *x, const char *symbol)
+{
+  const struct YQuote *q = ght_get(yql_quotes, symbol, sizeof(struct YQuote));
+  int k = x->nstrikes, n = YARRAY_LENGTH, a = 0, b = 0;
+  for (int i = 0; q && i < k; i++) {
+    if (x->strikes[i] > q->regularMarketPrice) {
+      a = i - n / 2, b = i + n / 2;
+      if (a < 0) {
+        b = min(b + (0 - a), k), a = max(0, a);
+      }
+      if (b > k) {
+        a = max(a - (b - k), 0), b = min(b, k);
+      }
+      break;
+    }
+  }
+  x->o.count = min(k, a + n) - a;
+  memcpy(x->o.strikes, x->strikes + a, x->o.count * sizeof(double));
+}
+
+static void json_optionChain_value(struct YJson *j, enum JStreamEvent e, const char *path, const char *name, const char *s)
+{
+  struct YOptionScratch *x = j->scratch;
+  if (!*path) {
+    if (name && strcmp(name, "underlyingSymbol") == 0) {
+      json_set(YFIELD_STRING, x->o.underlyingSymbol, sizeof(YString), e, s);
+    }
+  } else if (strcmp(path, "/expirationDates") == 0) {
+    size_t i = json_index(j);
+    if (e >= JSTREAM_STRING && i < EXPIRATION_DATES) {
+      json_set(YFIELD_INT, &x->o.expirationDates[i], sizeof(int64_t), e, s);
+    }
+  } else if (strcmp(path, "/strikes") == 0) {
+    if (e == JSTREAM_ARRAY_END) {
+      json_strikes(x, j->symbol);
+    } else if (e >= JSTREAM_STRING) {
+      if (x->nstrikes == x->capacity) {
+        size_t capacity = x->capacity ? x->capacity * 2 : YARRAY_LENGTH;
+        double *strikes = reallocarray(x->strikes, capacity, sizeof(double));
+        if (!strikes) {
+          log_error(logger, "%s:%d: reallocarray(%zu): %s\n", __FILE__, __LINE__, capacity, strerror(errno));
+          return;
+        }
+        x->strikes = strikes, x->capacity = capacity;
+      }
+      json_set(YFIELD_DOUBLE, &x->strikes[x->nstrikes++], sizeof(double), e, s);
+    }
+  } else if (strcmp(path, "/options/*") == 0 && name) {
+    if (strcmp(name, "expirationDate") == 0) {
+      json_set(YFIELD_INT, &x->o.expirationDate, sizeof(int64_t), e, s);
+    } else if (strcmp(name, "hasMiniOptions") == 0) {
+      json_set(YFIELD_BOOL, &x->o.hasMiniOptions, sizeof(bool), e, s);
+    }
+  } else if (strcmp(path, "/options/*/calls/*") == 0) {
+    if (e == JSTREAM_OBJECT_END) {
+      json_option_put(&x->o, x->o.calls, &x->call);
+    } else if (name) {
+      json_option(&x->call, e, name, s);
+    }
+  } else if (strcmp(path, "/options/*/puts/*") == 0) {
+    if (e == JSTREAM_OBJECT_END) {
+      json_option_put(&x->o, x->o.puts, &x->put);
+    } else if (name) {
+      json_option(&x->put, e, name, s);
+    }
+  } else if (strcmp(path, "/options/*/straddles/*") == 0) {
+    if (e == JSTREAM_OBJECT_END) {
+      x->call.strike = x->put.strike = x->strike;
+      json_option_put(&x->o, x->o.calls, &x->call);
+      json_option_put(&x->o, x->o.puts, &x->put);
+    } else if (name && strcmp(name, "strike") == 0) {
+      json_set(YFIELD_DOUBLE, &x->strike, sizeof(double), e, s);
+    }
+  } else if (strcmp(path, "/options/*/straddles/*/call") == 0 && name) {
+    json_option(&x->call, e, name, s);
+  } else if (strcmp(path, "/options/*/straddles/*/put") == 0 && name) {
+    json_option(&x->put, e, name, s);
+  }
+}
+
+static void json_optionChain_close(struct YJson *j)
+{
+  struct YOptionScratch *x = j->scratch;
+  assert(strncmp(x->o.underlyingSymbol, j->symbol, YSTRING_LENGTH) == 0);
+  struct YOptionChain *o = ght_get(yql_optionChains, j->symbol, sizeof(struct YOptionChain));
+  if (o) {
+    memcpy(o, &x->o, sizeof(struct YOptionChain));
+  }
+  memset(&x->o, 0, sizeof(struct YOptionChain));
+  x->nstrikes = 0;
+}
+
+static void json_optionChain_discard(struct YJson *j)
+{
+  struct YOptionScratch *x = j->scratch;
+  free(x->strikes);
+}
+
+/* Names only: a fundamental is its index in the table */
+#define YFUNDAMENTAL_FIELD(n) { #n, YFIELD_DOUBLE, 0, sizeof(double) },
+static const struct YField yfundamental_fields[] = { YFUNDAMENTAL_TYPES(YFUNDAMENTAL_FIELD) };
+#undef YFUNDAMENTAL_FIELD
+
+static struct YFieldIndex yfundamental_index;
+
+static const char * const yfrequency_prefixes[YFREQUENCIES] = { "annual", "quarterly" };
+
+#define YFundamentals_resize(v, n) YFundamentals_realloc((void **) &(v), n, sizeof(*(v)))
+
+static bool YFundamentals_realloc(void **v, size_t n, size_t size)
+{
+  void *p = reallocarray(*v, n, size);
+  if (!p) {
+    log_error(logger, "%s:%d: reallocarray(%zu, %zu): %s\n", __FILE__, __LINE__, n, size, strerror(errno));
+    return false;
+  }
+  *v = p;
+  return true;
+}
+
+/* Columns grown so far keep their room if a later one fails */
+static int YFundamentals_grow(struct YFundamentals *F)
+{
+  size_t n = F->capacity ? F->capacity * 2 : YARRAY_LENGTH, m = n * YFUNDAMENTAL_PERIODS;
+  bool ok = YFundamentals_resize(F->symbols, n) && YFundamentals_resize(F->asOfDates, n) &&
+    YFundamentals_resize(F->changed, n);
+  for (int f = 0; ok && f < YFREQUENCIES; f++) {
+    ok = YFundamentals_resize(F->counts[f], n) && YFundamentals_resize(F->dates[f], m);
+    for (int t = 0; ok && t < YFUNDAMENTALS; t++) {
+      ok = YFundamentals_resize(F->values[f][t], m);
+    }
+  }
+  if (!ok) {
+    return YERROR_CERR;
+  }
+  F->capacity = n;
+  return YERROR_NERR;
+}
+
+static void YFundamentals_free(struct YFundamentals *F)
+{
+  free(F->symbols);
+  free(F->asOfDates);
+  free(F->changed);
+  for (int f = 0; f < YFREQUENCIES; f++) {
+    free(F->counts[f]);
+    free(F->dates[f]);
+    for (int t = 0; t < YFUNDAMENTALS; t++) {
+      free(F->values[f][t]);
+    }
+  }
+  memset(F, 0, sizeof(struct YFundamentals));
+}
+
+static long YFundamentals_add(struct YFundamentals *F, const char *s)
+{
+  long r = yql_fundamentals_row(s);
+  if (r >= 0) {
+    return r;
+  }
+  if (F->rows == F->capacity && YFundamentals_grow(F) != YERROR_NERR) {
+    return -1;
+  }
+  char *k = strndup(s, YSTRING_LENGTH);
+  if (!k) {
+    log_error(logger, "%s:%d: strndup(%s): %s\n", __FILE__, __LINE__, s, strerror(errno));
+    return -1;
+  }
+  r = F->rows++;
+  YString_copy(F->symbols[r], k);
+  F->symbols[r][YSTRING_LENGTH] = '\0';
+  F->asOfDates[r][0] = '\0';
+  F->changed[r] = false;
+  for (int f = 0; f < YFREQUENCIES; f++) {
+    F->counts[f][r] = 0;
+  }
+  g_hash_table_insert(yql_fundamental_rows, k, GSIZE_TO_POINTER(r + 1));
+  return r;
+}
+
+/**
+ * Opens a period before position p of row r, shifting the later ones up,
+ * or once the row is full, dropping the oldest and shifting the earlier
+ * ones down.  Returns where the period now is, with every value NAN.
+ */
+static size_t YFundamentals_open(struct YFundamentals *F, enum YFrequency f, size_t r, size_t p)
+{
+  size_t n = F->counts[f][r], base = r * YFUNDAMENTAL_PERIODS, from = 0, to = 0, k = 0;
+  if (n < YFUNDAMENTAL_PERIODS) {
+    from = base + p, to = from + 1, k = n - p;
+    F->counts[f][r]++;
+  } else {
+    p--, from = base + 1, to = base, k = p;
+  }
+  memmove(&F->dates[f][to], &F->dates[f][from], k * sizeof(YDate));
+  for (int t = 0; t < YFUNDAMENTALS; t++) {
+    memmove(&F->values[f][t][to], &F->values[f][t][from], k * sizeof(double));
+    F->values[f][t][base + p] = NAN;
+  }
+  return p;
+}
+
+/* The as-of date is the earliest of the latest periods held at each frequency */
+static void YFundamentals_asOf(struct YFundamentals *F, size_t r)
+{
+  const char *asOf = NULL;
+  for (int f = 0; f < YFREQUENCIES; f++) {
+    size_t n = F->counts[f][r];
+    if (n && (!asOf || strcmp(YFundamentals_date(F, f, r, n - 1), asOf) < 0)) {
+      asOf = YFundamentals_date(F, f, r, n - 1);
+    }
+  }
+  strncpy(F->asOfDates[r], asOf ? asOf : "", YDATE_LENGTH);
+  F->asOfDates[r][YDATE_LENGTH] = '\0';
+}
+
+long yql_fundamentals_row(const char *s)
+{
+  return (long) GPOINTER_TO_SIZE(g_hash_table_lookup(yql_fundamental_rows, s)) - 1;
+}
+
+const char *yql_fundamental_name(enum YFundamental t)
+{
+  return yfundamental_fields[t].name;
+}
+
+int yql_fundamental_type(const char *name)
+{
+  const struct YField *f = YFieldIndex_get(&yfundamental_index, name);
+  return f ? f - yfundamental_fields : -1;
+}
+
+/**
+ * Stores the value of t for the period of frequency f ending on date,
+ * opening the period in date order if it is not held yet.  A full row
+ * drops its oldest period to make room; periods older than all of those
+ * held by a full row are ignored.
+ */
+void yql_fundamentals_put(const char *s, enum YFrequency f, enum YFundamental t, const char *date, double value)
+{
+  struct YFundamentals *F = &yql_fundamentals;
+  long r = YFundamentals_add(F, s);
+  if (r < 0) {
+    return;
+  }
+
+  size_t n = F->counts[f][r], p = n;
+  while (p > 0 && strncmp(YFundamentals_date(F, f, r, p - 1), date, YDATE_LENGTH) > 0) {
+    p--;
+  }
+  if (p == 0 || strncmp(YFundamentals_date(F, f, r, p - 1), date, YDATE_LENGTH) != 0) {
+    if (p == 0 && n == YFUNDAMENTAL_PERIODS) {
+      return;
+    }
+    p = YFundamentals_open(F, f, r, p);
+    strncpy(YFundamentals_date(F, f, r, p), date, YDATE_LENGTH);
+    YFundamentals_date(F, f, r, p)[YDATE_LENGTH] = '\0';
+    YFundamentals_asOf(F, r);
+  } else {
+    p--;
+  }
+  YFundamentals_value(F, f, t, r, p) = value;
+  F->changed[r] = true;
+}
+
+void yql_fundamentals_saved(long r)
+{
+  if (r >= 0 && (size_t) r < yql_fundamentals.rows) {
+    yql_fundamentals.changed[r] = false;
+  }
+}
+
+struct YTimeseriesScratch
+{
+  YDate  date;
+  double value;
+  bool   reported;
+};
+
+/* Resolves the frequency and fundamental of the series member a path starts with */
+static bool json_timeseries_type(const char *path, enum YFrequency *f, enum YFundamental *t)
+{
+  char name[YJSON_KEY_LENGTH + 1];
+  const char *end = strchr(path + 1, '/');
+  size_t n = end ? (size_t) (end - path - 1) : strlen(path + 1);
+  if (n > YJSON_KEY_LENGTH) {
+    return false;
+  }
+  memcpy(name, path + 1, n);
+  name[n] = '\0';
+  for (int i = 0; i < YFREQUENCIES; i++) {
+    size_t k = strlen(yfrequency_prefixes[i]);
+    int type = -1;
+    if (strncmp(name, yfrequency_prefixes[i], k) == 0 && (type = yql_fundamental_type(name + k)) >= 0) {
+      *f = i, *t = type;
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Every data point of a series is an object stored as it closes, so the
+ * series may come in any order; null points, for periods not reported, and
+ * the meta and timestamp members are skipped.
+ */
+static void json_timeseries_value(struct YJson *j, enum JStreamEvent e, const char *path, const char *name, const char *s)
+{
+  struct YTimeseriesScratch *x = j->scratch;
+  const char *point = strchr(path + 1, '/');
+  enum YFrequency f;
+  enum YFundamental t;
+  if (name && e == JSTREAM_STRING && strcmp(name, "asOfDate") == 0) {
+    strncpy(x->date, s, YDATE_LENGTH);
+    x->date[YDATE_LENGTH] = '\0';
+  } else if (name && e == JSTREAM_NUMBER && strcmp(name, "raw") == 0 && point && strcmp(point, "/*/reportedValue") == 0) {
+    x->value = strtod(s, NULL), x->reported = true;
+  } else if (e == JSTREAM_OBJECT_END && point && strcmp(point, "/*") == 0) {
+    if (*x->date && x->reported && json_timeseries_type(path, &f, &t)) {
+      yql_fundamentals_put(j->symbol, f, t, x->date, x->value);
+    }
+    memset(x, 0, sizeof(struct YTimeseriesScratch));
+  }
+}
+
+static void json_timeseries_close(struct YJson *j)
+{
+  memset(j->scratch, 0, sizeof(struct YTimeseriesScratch));
+}
+
+static const struct YDecoder json_decoders[] = {
+  { "quoteResponse", sizeof(struct YQuoteScratch),      json_quote_value,       json_quote_close,       NULL },
+  { "chart",         sizeof(struct YChart),             json_chart_value,       json_chart_close,       NULL },
+  { "optionChain",   sizeof(struct YOptionScratch),     json_optionChain_value, json_optionChain_close, json_optionChain_discard },
+  { "timeseries",    sizeof(struct YTimeseriesScratch), json_timeseries_value,  json_timeseries_close,  NULL },
+};
+
+/* Picks the decoder for the response; returns false to have it buffered instead */
+static bool json_decoder(struct YJson *j, const char *response)
+{
+  YString_copy(j->response, response);
+  for (size_t i = 0; i < sizeof(json_decoders) / sizeof(json_decoders[0]); i++) {
+    if (strcmp(json_decoders[i].response, response) == 0) {
+      j->scratch = YArena_alloc(j->arena, json_decoders[i].size);
+      if (!j->scratch) {
+        return false;
+      }
+      memset(j->scratch, 0, json_decoders[i].size);
+      j->decoder = &json_decoders[i];
+      j->mode = YJSON_STREAM;
+      return true;
+    }
+  }
+  j->mode = YJSON_BUFFER;
+  return false;
+}
+
+static int json_event(void *user, enum JStreamEvent e, const char *s, size_t n _U_)
+{
+  struct YJson *j = user;
+  if (e == JSTREAM_KEY) {
+    strncpy(j->key, s, YJSON_KEY_LENGTH);
+    return 0;
+  }
+
+  bool tracked = j->depth > 0 && j->depth <= YJSON_DEPTH;
+  const char *name = tracked && !j->frames[j->depth - 1].array ? j->key : NULL;
+  const char *rel = j->path + (j->depth >= YJSON_ELEMENT ? j->frames[YJSON_ELEMENT - 1].end : 0);
+
+  switch (e) {
+  case JSTREAM_OBJECT:
+  case JSTREAM_ARRAY:
+    if (j->depth == 1 && j->mode == YJSON_PENDING && name) {
+      if (!json_decoder(j, name)) {
+        return 1; /* the rest is buffered */
+      }
+    }
+    if (j->depth == 2 && name && strcmp(name, "error") == 0) {
+      j->error = true;
+    } else if (j->depth == 2 && name && strcmp(name, "result") == 0) {
+      j->result = e == JSTREAM_ARRAY;
+    }
+    if (j->depth < YJSON_DEPTH) {
+      size_t end = j->depth > 0 ? j->frames[j->depth - 1].end : 0;
+      int m = snprintf(j->path + end, sizeof(j->path) - end, "/%s", name ? name : "*");
+      j->frames[j->depth].array = e == JSTREAM_ARRAY;
+      j->frames[j->depth].count = 0;
+      j->frames[j->depth].end = min(end + m, sizeof(j->path) - 1);
+    }
+    j->depth++;
     return 0;
+  case JSTREAM_OBJECT_END:
+  case JSTREAM_ARRAY_END:
+    if (tracked && j->result) {
+      if (j->depth == YJSON_ELEMENT) {
+        j->decoder->close(j);
+      } else if (j->depth > YJSON_ELEMENT) {
+        j->decoder->value(j, e, rel, NULL, NULL);
+      } else if (j->depth == YJSON_ELEMENT - 1) {
+        j->empty = json_index(j) == 0;
+        j->result = false;
+      }
+    }
+    j->depth--;
+    if (j->depth > 0 && j->depth <= YJSON_DEPTH) {
+      j->path[j->frames[j->depth - 1].end] = '\0';
+    } else if (j->depth == 0) {
+      j->path[0] = '\0';
+    }
+    break;
+  default:
+    if (tracked && j->result && j->depth >= YJSON_ELEMENT) {
+      j->decoder->value(j, e, rel, name, s);
+    } else if (tracked && j->depth == 3 && j->error && name && e == JSTREAM_STRING) {
+      if (strcmp(name, "code") == 0) {
+        YString_copy(j->code, s);
+      } else if (strcmp(name, "description") == 0) {
+        strncpy(j->description, s, YTEXT_LENGTH);
+      }
+    }
+    break;
+  }
+
+  if (j->depth > 0 && j->depth <= YJSON_DEPTH && j->frames[j->depth - 1].array) {
+    j->frames[j->depth - 1].count++;
+  }
+  return 0;
+}
+
+static size_t json_stream(struct YRequest *r, const char *p, size_t n, bool merge)
+{
+  struct YJson *j = r->stream;
+  if (!j) {
+    j = r->stream = YArena_alloc(&r->arena, sizeof(struct YJson));
+    if (!j) {
+      return 0;
+    }
+    memset(j, 0, sizeof(struct YJson));
+    jstream_init(&j->stream, json_event, j);
+    j->arena = &r->arena, j->symbol = r->symbol, j->merge = merge;
+  }
+
+  /* Held until the response name shows whether it is needed */
+  if (j->mode != YJSON_STREAM && http_buffer_write((char *) p, 1, n, &r->buffer) != n) {
+    return 0;
+  }
+  if (j->mode != YJSON_BUFFER && !j->failed) {
+    if (jstream_feed(&j->stream, p, n) != JSTREAM_OK && j->mode != YJSON_BUFFER) {
+      j->failed = true;
+    }
+    if (j->mode == YJSON_STREAM) {
+      http_buffer_release(&r->buffer);
+    }
+  }
+  return n;
+}
+
+static size_t json_write(char *p, size_t size, size_t nmemb, void *user)
+{
+  return json_stream(user, p, size * nmemb, false);
+}
+
+static size_t json_write_merge(char *p, size_t size, size_t nmemb, void *user)
+{
+  return json_stream(user, p, size * nmemb, true);
+}
+
+static int json_finish(struct YRequest *r)
+{
+  struct YJson *j = r->stream;
+  if (!j || j->mode != YJSON_STREAM) {
+    return json_load(&r->buffer, r->symbol);
+  }
+  if (j->failed || jstream_end(&j->stream) != JSTREAM_OK) {
+    log_warn(logger, "jstream_feed(%s): malformed at byte %zu\n", r->url, j->stream.offset);
+    return YERROR_JSON;
+  }
+  if (j->error || j->empty) {
+    strncpy(yql_error.response, j->response, YSTRING_LENGTH);
+    strncpy(yql_error.code, j->error ? j->code : "YError: " YERROR_CODE, YSTRING_LENGTH);
+    strncpy(yql_error.description, j->error ? j->description : YERROR_DESCRIPTION, YTEXT_LENGTH);
+    log_warn(logger, "YError: response=%s, code=%s, description=%s\n", yql_error.response, yql_error.code, yql_error.description);
+    return YERROR_YHOO;
+  }
+  return YERROR_NERR;
+}
+
+static void json_discard(struct YRequest *r)
+{
+  struct YJson *j = r->stream;
+  if (j && j->decoder && j->decoder->discard) {
+    j->decoder->discard(j);
+  }
+  r->stream = NULL; /* its memory stays with the arena */
+  http_buffer_release(&r->buffer);
+}
+
+int yql_init()
+{
+  log_open(&logger, LOG_FILENAME);
+
+  yql_quotes = g_hash_table_new_full(g_str_hash, g_str_equal, free, free);
+  yql_quoteSummaries = g_hash_table_new_full(g_str_hash, g_str_equal, free, free);
+  yql_charts = g_hash_table_new_full(g_str_hash, g_str_equal, free, free);
+  yql_optionChains = g_hash_table_new_full(g_str_hash, g_str_equal, free, free);
+  yql_headlines = g_hash_table_new_full(g_str_hash, g_str_equal, free, YHeadline_destroy);
+  yql_fundamental_rows = g_hash_table_new_full(g_str_hash, g_str_equal, free, NULL);
+  yql_flights = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, free);
+  yql_stamps = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, free);
+  pthread_key_create(&yarena_key, YArena_drain);
+
+  const struct
+  {
+    struct YFieldIndex  *index;
+    const struct YField *fields;
+    size_t               count;
+  } indexes[] = {
+    { &yquote_index,                YFIELDS(yquote_fields) },
+    { &yassetProfile_index,         YFIELDS(yassetProfile_fields) },
+    { &ycompanyOfficer_index,       YFIELDS(ycompanyOfficer_fields) },
+    { &ydefaultKeyStatistics_index, YFIELDS(ydefaultKeyStatistics_fields) },
+    { &yfinancialData_index,        YFIELDS(yfinancialData_fields) },
+    { &ychart_meta_index,           YFIELDS(ychart_meta) },
+    { &ychart_series_index,         YFIELDS(ychart_series) },
+    { &yoption_index,               YFIELDS(yoption_fields) },
+    { &yfundamental_index,          YFIELDS(yfundamental_fields) },
+  };
+  for (size_t i = 0; i < sizeof(indexes) / sizeof(indexes[0]); i++) {
+    if (YFieldIndex_build(indexes[i].index, indexes[i].fields, indexes[i].count) != YERROR_NERR) {
+      log_error(logger, "YFieldIndex_build(%s)\n", indexes[i].fields[0].name);
+      return YERROR_CERR;
+    }
+  }
+
+  csv_locale = newlocale(LC_NUMERIC_MASK, "C", (locale_t) 0);
+  if (csv_locale == (locale_t) 0) {
+    log_error(logger, "%s:%d: newlocale(): %s\n", __FILE__, __LINE__, strerror(errno));
+    return YERROR_CERR;
+  }
+
+  if (http_init() != HTTP_OK) {
+    log_error(logger, "http_init()\n");
+    return YERROR_CURL;
+  }
+
+  return YERROR_NERR;
+}
+
+void yql_free()
+{
+  xmlCleanupParser();
+
+  struct YArenaCache *cache = pthread_getspecific(yarena_key);
+  if (cache) {
+    pthread_setspecific(yarena_key, NULL);
+    YArena_drain(cache);
+  }
+  pthread_key_delete(yarena_key);
+
+  freelocale(csv_locale);                   csv_locale = (locale_t) 0;
+
+  g_hash_table_destroy(yql_stamps);         yql_stamps = NULL;
+  g_hash_table_destroy(yql_flights);        yql_flights = NULL;
+  g_hash_table_destroy(yql_fundamental_rows); yql_fundamental_rows = NULL;
+  YFundamentals_free(&yql_fundamentals);
+  g_hash_table_destroy(yql_headlines);      yql_headlines = NULL;
+  g_hash_table_destroy(yql_optionChains);   yql_optionChains = NULL;
+  g_hash_table_destroy(yql_charts);         yql_charts = NULL;
+  g_hash_table_destroy(yql_quoteSummaries); yql_quoteSummaries = NULL;
+  g_hash_table_destroy(yql_quotes);         yql_quotes = NULL;
+
+  log_close(logger);                        logger = NULL;
+}
+
+static const struct YFormat json_format  = { json_write, json_finish, json_discard };
+static const struct YFormat merge_format = { json_write_merge, json_finish, json_discard };
+
+static int pstrcmp(const void *p, const void *q)
+{
+  return strcmp(*(char * const *) p, *(char * const *) q);
+}
+
+/**
+ * Canonical form of a request URL: both query hosts map to Y_HOST1 and the
+ * query parameters are sorted, so equivalent requests share one key.
+ */
+static char *yql_normalize(struct YArena *a, const char *url)
+{
+  const char *host = "";
+  if (strncmp(url, Y_HOST2, strlen(Y_HOST2)) == 0) {
+    host = Y_HOST1;
+    url += strlen(Y_HOST2);
+  }
+  size_t hlen = strlen(host), len = strlen(url);
+  char *key = YArena_alloc(a, hlen + len + 1);
+  if (!key) {
+    return NULL;
+  }
+  memcpy(key, host, hlen);
+
+  const char *query = strchr(url, '?');
+  if (!query) {
+    memcpy(key + hlen, url, len + 1);
+    return key;
+  }
+  char *k = key + hlen;
+  memcpy(k, url, query - url + 1);
+  k += query - url + 1;
+
+  char *params = YArena_strndup(a, query + 1, len);
+  size_t n = 1;
+  for (const char *c = query + 1; *c; c++) {
+    n += *c == '&';
+  }
+  char **v = YArena_alloc(a, n * sizeof(char *));
+  if (!params || !v) {
+    return NULL;
+  }
+  n = 0;
+  for (char *tok = params, *savetok = NULL; (tok = strtok_r(tok, "&", &savetok)); tok = NULL) {
+    v[n++] = tok;
+  }
+  qsort(v, n, sizeof(char *), pstrcmp);
+  for (size_t i = 0; i < n; i++) {
+    size_t l = strlen(v[i]);
+    if (i) {
+      *k++ = '&';
+    }
+    memcpy(k, v[i], l);
+    k += l;
+  }
+  *k = 0;
+  return key;
+}
+
+/**
+ * Returns true if the request is already covered by an identical flight:
+ * one in progress on this thread's multi handle, one another thread is
+ * performing (waited for), or one completed less than YFLIGHT_LINGER ago.
+ * Otherwise registers a new flight owned by the caller and returns false.
+ */
+static bool yql_flight_join(const char *key, int *status)
+{
+  pthread_mutex_lock(&flight_lock);
+  struct YFlight *f = g_hash_table_lookup(yql_flights, key);
+  while (f && !f->done && !pthread_equal(f->owner, pthread_self())) {
+    pthread_cond_wait(&flight_cond, &flight_lock);
+    f = g_hash_table_lookup(yql_flights, key);
+  }
+
+  bool joined = false;
+  if (f && (!f->done || g_get_monotonic_time() - f->time < YFLIGHT_LINGER)) {
+    *status = f->done ? f->status : YERROR_NERR;
+    joined = true;
+  } else {
+    if (!f) {
+      f = malloc(sizeof(struct YFlight));
+      g_hash_table_insert(yql_flights, g_strdup(key), f);
+    }
+    f->owner = pthread_self(), f->done = false, f->status = YERROR_NERR, f->time = 0;
+  }
+  pthread_mutex_unlock(&flight_lock);
+  return joined;
+}
+
+static void yql_flight_land(const char *key, int status)
+{
+  pthread_mutex_lock(&flight_lock);
+  struct YFlight *f = g_hash_table_lookup(yql_flights, key);
+  if (f) {
+    f->done = true, f->status = status, f->time = g_get_monotonic_time();
+  }
+  pthread_cond_broadcast(&flight_cond);
+  pthread_mutex_unlock(&flight_lock);
+}
+
+static gboolean yql_flight_expired(gpointer key _U_, gpointer value, gpointer now)
+{
+  const struct YFlight * const f = value;
+  return f->done && *(int64_t *) now - f->time >= YFLIGHT_LINGER;
+}
+
+static void yql_flight_prune()
+{
+  int64_t now = g_get_monotonic_time();
+  pthread_mutex_lock(&flight_lock);
+  g_hash_table_foreach_remove(yql_flights, yql_flight_expired, &now);
+  pthread_mutex_unlock(&flight_lock);
+}
+
+static int64_t yql_ttl(const char *key)
+{
+  for (size_t i = 0; i < sizeof(yql_ttls) / sizeof(yql_ttls[0]); i++) {
+    if (strncmp(key, yql_ttls[i].prefix, strlen(yql_ttls[i].prefix)) == 0) {
+      return yql_ttls[i].ttl * G_USEC_PER_SEC;
+    }
+  }
+  return 0;
+}
+
+static void yql_stamp(const char *key)
+{
+  int64_t *t = malloc(sizeof(int64_t));
+  if (t) {
+    *t = g_get_monotonic_time();
+    pthread_mutex_lock(&stamp_lock);
+    g_hash_table_replace(yql_stamps, g_strdup(key), t);
+    pthread_mutex_unlock(&stamp_lock);
+  }
+}
+
+/**
+ * Returns the age of the cached response for key in microseconds, or -1 if
+ * nothing was cached or the endpoint is not cacheable.
+ */
+static int64_t yql_age(const char *key, int64_t ttl)
+{
+  if (ttl <= 0) {
+    return -1;
+  }
+  pthread_mutex_lock(&stamp_lock);
+  const int64_t *t = g_hash_table_lookup(yql_stamps, key);
+  int64_t age = t ? g_get_monotonic_time() - *t : -1;
+  pthread_mutex_unlock(&stamp_lock);
+  return age;
+}
+
+/**
+ * Points a query URL at whichever of Y_HOST1 and Y_HOST2 currently answers
+ * best.  Both host prefixes have the same length, so this is done in place.
+ */
+static bool yql_route(char *url)
+{
+  static const char * const hosts[] = { Y_HOST1, Y_HOST2 };
+  if (strncmp(url, Y_HOST1, strlen(Y_HOST1)) != 0 && strncmp(url, Y_HOST2, strlen(Y_HOST2)) != 0) {
+    return false;
+  }
+  const char *host = hosts[http_pick(hosts, 2)];
+  if (strncmp(url, host, strlen(host)) == 0) {
+    return false;
+  }
+  memcpy(url, host, strlen(host));
+  return true;
+}
+
+static void YRequest_free(struct YRequest *r)
+{
+  if (r) {
+    if (r->easy) {
+      curl_easy_cleanup(r->easy);
+    }
+    if (r->format) {
+      r->format->discard(r);
+    }
+    struct YArena a = r->arena; /* r lives in its own arena */
+    YArena_reset(&a);
+  }
+}
+
+/**
+ * Queues a request on m.  A fresh cached response is served as is; a stale
+ * one is served as is while a background revalidation is queued instead.
+ */
+static int yql_request(struct YMulti *m, const char *url, const char *alias, const char *symbol,
+                       const struct YFormat *format, const void *user)
+{
+  struct YArena a = { .head = NULL };
+  char *key = yql_normalize(&a, alias ? alias : url);
+  if (!key) {
+    YArena_reset(&a);
+    return YERROR_CERR;
+  }
+  int64_t ttl = yql_ttl(key);
+  int64_t age = yql_age(key, ttl);
+  if (age >= 0 && age < ttl) {
+    log_debug(logger, "yql_request(%s): fresh\n", url);
+    YArena_reset(&a);
+    return YERROR_NERR;
+  }
+  if (age >= 0 && m != &revalidate && revalidate.handle) {
+    log_debug(logger, "yql_request(%s): stale, revalidating\n", url);
+    YArena_reset(&a);
+    yql_request(&revalidate, url, alias, symbol, format, user);
+    return YERROR_NERR;
+  }
+
+  int status = YERROR_NERR;
+  if (yql_flight_join(key, &status)) {
+    log_debug(logger, "yql_request(%s): coalesced\n", url);
+    YArena_reset(&a);
+    return status;
+  }
+
+  struct YRequest *r = YArena_alloc(&a, sizeof(struct YRequest));
+  if (!r) {
+    yql_flight_land(key, YERROR_CERR);
+    YArena_reset(&a);
+    return YERROR_CERR;
+  }
+  memset(r, 0, sizeof(struct YRequest));
+  r->key = key;
+  r->url = YArena_strndup(&a, url, strlen(url));
+  r->symbol = YArena_strndup(&a, symbol, YSTRING_LENGTH);
+  r->arena = a;
+  r->format = format;
+  r->user = user;
+  r->easy = http_easy_init();
+  if (!r->url || !r->symbol || !r->easy) {
+    log_error(logger, "%s:%d: yql_request(%s)\n", __FILE__, __LINE__, url);
+    yql_flight_land(r->key, YERROR_CERR);
+    YRequest_free(r);
+    return YERROR_CERR;
+  }
+
+  curl_easy_setopt(r->easy, CURLOPT_PRIVATE, r);
+  r->not_before = g_get_monotonic_time() + http_latency();
+
+  g_ptr_array_add(m->requests, r);
+  return YERROR_NERR;
+}
+
+/**
+ * fetched is false when rstatus comes from anything but a response, such as
+ * the cache served by an open circuit, which must not count as fresh.
+ */
+static int yql_multi_land(struct YMulti *m, struct YRequest *r, int (*done)(int, const char *), int status, int rstatus, bool fetched)
+{
+  if (fetched && rstatus == YERROR_NERR && yql_ttl(r->key) > 0) {
+    yql_stamp(r->key);
+  }
+  yql_flight_land(r->key, rstatus);
+  if (done) {
+    done(rstatus, r->symbol);
+  }
+  g_ptr_array_remove_fast(m->requests, r);
+  YRequest_free(r);
+  return status == YERROR_NERR ? rstatus : status;
+}
+
+/**
+ * Adds every queued request whose backoff has elapsed to the multi handle,
+ * as far as the per-host rate limiter admits them.  Requests refused by an
+ * open circuit land immediately, successfully if the cache holds an older
+ * response, which stays stale so it is fetched once the circuit closes.
+ * Returns the microseconds until the next queued request is
+ * due, or -1 if none is waiting.
+ */
+static int yql_multi_complete(struct YMulti *m, struct YRequest *r, int (*done)(int, const char *), int status);
+
+static int64_t yql_multi_launch(struct YMulti *m, int (*done)(int, const char *), int *status)
+{
+  int64_t next = -1;
+  int64_t now = g_get_monotonic_time();
+  for (guint i = 0; i < m->requests->len; ) {
+    struct YRequest *r = g_ptr_array_index(m->requests, i);
+    int64_t wait = r->not_before - now;
+    if (r->active) {
+      i++;
+      continue;
+    }
+    if (r->held && wait <= 0) {
+      if ((wait = http_drain(r->easy)) > 0) {
+        r->not_before = now + wait;
+      } else {
+        guint n = m->requests->len;
+        r->held = false;
+        *status = yql_multi_complete(m, r, done, *status);
+        if (m->requests->len < n) {
+          continue; /* Landed, and replaced by the last request */
+        }
+        wait = r->not_before - now;
+      }
+    } else if (wait <= 0) {
+      yql_route(r->url);
+      int admit = http_admit(r->url, &wait);
+      if (admit == HTTP_OK) {
+        http_prepare(r->easy, r->url, r->format->write, r);
+        CURLMcode code = curl_multi_add_handle(m->handle, r->easy);
+        if (code != CURLM_OK) {
+          log_error(logger, "curl_multi_add_handle(%s): %s\n", r->url, curl_multi_strerror(code));
+          *status = yql_multi_land(m, r, done, *status, YERROR_CURL, false);
+          continue;
+        }
+        r->active = true;
+        i++;
+        continue;
+      } else if (admit == HTTP_BROKEN) {
+        log_warn(logger, "yql_request(%s): circuit open\n", r->url);
+        bool cached = yql_age(r->key, yql_ttl(r->key)) >= 0;
+        *status = yql_multi_land(m, r, done, *status, cached ? YERROR_NERR : YERROR_CURL, false);
+        continue;
+      }
+      r->not_before = now + wait;
+    }
+    next = next < 0 ? wait : min64(next, wait);
+    i++;
+  }
+  return next;
+}
+
+/**
+ * Reports the finished transfer of r, then either queues its retry or
+ * parses and lands it.
+ */
+static int yql_multi_complete(struct YMulti *m, struct YRequest *r, int (*done)(int, const char *), int status)
+{
+  int rstatus = YERROR_NERR;
+  if (http_report(r->url, r->easy, r->result) == HTTP_AGAIN) {
+    if (r->attempts < HTTP_RETRIES) {
+      int64_t delay = http_backoff(r->easy, r->attempts++);
+      log_warn(logger, "yql_request(%s): retry %d in %ldms\n", r->url, r->attempts, (long) (delay / 1000));
+      r->not_before = g_get_monotonic_time() + delay;
+      r->format->discard(r);
+      return status;
+    }
+    log_warn(logger, "yql_request(%s): giving up after %d retries\n", r->url, r->attempts);
+    rstatus = YERROR_CURL;
+  } else {
+    rstatus = r->format->parse(r);
+  }
+  return yql_multi_land(m, r, done, status, rstatus, true);
+}
+
+/**
+ * Completes the transfers that finished, except those whose replayed body
+ * is still draining under the bandwidth cap: yql_multi_launch() completes
+ * them once it is due.
+ */
+static int yql_multi_read(struct YMulti *m, int (*done)(int, const char *), int status)
+{
+  CURLMsg *msg = NULL;
+  int n = 0;
+  while ((msg = curl_multi_info_read(m->handle, &n))) {
+    if (msg->msg != CURLMSG_DONE) {
+      continue;
+    }
+
+    struct YRequest *r = NULL;
+    curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **) &r);
+    curl_multi_remove_handle(m->handle, msg->easy_handle);
+
+    r->active = false;
+    r->result = msg->data.result;
+
+    int64_t wait = http_drain(r->easy);
+    if (wait > 0) {
+      r->held = true;
+      r->not_before = g_get_monotonic_time() + wait;
+      continue;
+    }
+    status = yql_multi_complete(m, r, done, status);
+  }
+  return status;
+}
+
+/**
+ * Launches what is due on m, progresses the transfers and lands those that
+ * completed, then waits for activity until the next request is due.
+ */
+static CURLMcode yql_multi_step(struct YMulti *m, int (*done)(int, const char *), int *status)
+{
+  int running = 0;
+  int64_t wait = yql_multi_launch(m, done, status);
+  CURLMcode code = curl_multi_perform(m->handle, &running);
+  if (code == CURLM_OK) {
+    *status = yql_multi_read(m, done, *status);
+    if (running || wait >= 0) {
+      int timeout = wait >= 0 ? (int) min64(wait / 1000 + 1, YMULTI_TIMEOUT) : YMULTI_TIMEOUT;
+      code = curl_multi_poll(m->handle, NULL, 0, timeout, NULL);
+    }
+  }
+  if (code != CURLM_OK) {
+    log_error(logger, "curl_multi_perform(): %s\n", curl_multi_strerror(code));
+  }
+  return code;
+}
+
+static void yql_multi_abort(struct YMulti *m)
+{
+  for (guint i = 0; i < m->requests->len; i++) {
+    struct YRequest *r = g_ptr_array_index(m->requests, i);
+    if (r->active) {
+      curl_multi_remove_handle(m->handle, r->easy);
+    }
+    if (r->held) {
+      http_report(r->url, r->easy, CURLE_ABORTED_BY_CALLBACK); /* Ends its tee */
+    }
+    yql_flight_land(r->key, YERROR_CURL);
+    YRequest_free(r);
+  }
+  g_ptr_array_set_size(m->requests, 0);
+}
+
+static int yql_multi_open(struct YMulti *m)
+{
+  if (!m->handle) {
+    m->handle = http_multi_init();
+    if (!m->handle) {
+      log_error(logger, "http_multi_init()\n");
+      return YERROR_CURL;
+    }
+    m->requests = g_ptr_array_new();
+  }
+  return YERROR_NERR;
+}
+
+static void yql_multi_close(struct YMulti *m)
+{
+  if (m->handle) {
+    yql_multi_abort(m);
+    g_ptr_array_free(m->requests, TRUE); m->requests = NULL;
+    curl_multi_cleanup(m->handle);       m->handle = NULL;
   }
-  memcpy(&buffer->data[buffer->size], p, nsize);
-  buffer->size += nsize;
-  buffer->data[buffer->size] = 0;
-  return nsize;
 }
 
 int yql_open()
 {
   if (!easy) {
-    easy = curl_easy_init();
+    easy = http_easy_init();
     if (!easy) {
-      log_error(logger, "curl_easy_init()\n");
+      log_error(logger, "http_easy_init()\n");
       return YERROR_CURL;
     }
     curl_easy_setopt(easy, CURLOPT_VERBOSE, 0L);
     /* curl_easy_setopt(easy, CURLOPT_ERRORBUFFER, errbuf); */
-    curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, callback);
+    curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, http_buffer_write);
   }
-  return YERROR_NERR;
+  if (yql_multi_open(&multi) != YERROR_NERR) {
+    return YERROR_CURL;
+  }
+  return yql_multi_open(&revalidate);
 }
 
 void yql_close()
 {
+  yql_multi_close(&revalidate);
+  yql_multi_close(&multi);
   if (easy) {
     curl_easy_cleanup(easy);                easy = NULL;
   }
@@ -961,24 +2570,644 @@ struct YHeadline *yql_headline_at(const char *s, size_t i)
   return p;
 }
 
+const struct YFundamentals *yql_fundamentals_get()
+{
+  return &yql_fundamentals;
+}
+
 void yql_quote_foreach(GHFunc fp, gpointer p)
 {
-  g_hash_table_foreach(yql_quotes, fp, p);
+  g_hash_table_foreach(yql_quotes, fp, p);
+}
+
+/**
+ * Requests issued between yql_multi_begin() and yql_multi_end() are queued
+ * on the multi handle instead of performed, then transferred concurrently.
+ * Each response is parsed as soon as its transfer completes and reported to
+ * done(status, symbol).  Returns the first error status, if any.  Outside
+ * a batch every request still goes through the multi handle, so all yql
+ * transfers draw on one pool of keep-alive connections.
+ */
+int yql_multi_begin()
+{
+  if (!multi.handle) {
+    return YERROR_CURL;
+  }
+  multi_depth++;
+  return YERROR_NERR;
+}
+
+int yql_multi_end(int (*done)(int, const char *))
+{
+  if (multi_depth == 0 || --multi_depth > 0) {
+    return YERROR_NERR;
+  }
+
+  int status = YERROR_NERR;
+  while (multi.requests->len > 0) {
+    if (yql_multi_step(&multi, done, &status) != CURLM_OK) {
+      status = YERROR_CURL;
+      break;
+    }
+  }
+  status = yql_multi_read(&multi, done, status);
+  yql_multi_abort(&multi);
+  yql_flight_prune();
+  return status;
+}
+
+/*
+ * Streaming quotes.  One websocket to the streamer pushes a PricingData
+ * protobuf, base64 encoded, whenever a subscribed symbol trades; each is
+ * applied to the cached quote in place, so a watchlist follows the market
+ * without polling yql_quote().  A file:// source replays the same messages,
+ * one per line, from a recording or a FIFO fed by a test.
+ */
+
+enum YStreamKind
+{
+  YSTREAM_NONE,
+  YSTREAM_WEBSOCKET,
+  YSTREAM_FILE,
+};
+
+struct YStream
+{
+  enum YStreamKind kind;
+  char       *source;
+  CURLM      *multi;   /*< drives the websocket upgrade without blocking, holds easy */
+  CURL       *easy;    /*< websocket, or NULL */
+  bool        connected; /*< upgrade done, easy is read with curl_ws_recv() */
+  int         fd;      /*< replay, or -1 */
+  FILE       *record;  /*< messages received are appended for replay, or NULL */
+  GHashTable *symbols; /*< subscribed, YString -> YString */
+  char        buffer[YSTREAM_LENGTH + 1]; /*< message, or replayed lines, being read */
+  size_t      length;
+  bool        skip;    /*< rest of an overlong message is dropped */
+  int64_t     retry;   /*< monotonic time before which no connect is tried */
+  int64_t     backoff;
+};
+
+static struct YStream ystream = { .fd = -1 };
+
+/* PricingData fields that update a quote, by field number */
+struct YTickField
+{
+  enum YFieldType type;
+  int64_t         scale;     /*< divides INT values, 0 if the field is ignored */
+  size_t          offset[3]; /*< by session: pre, regular, post market */
+};
+
+#define YTICK_SESSION(t, k, pre, regular, post) \
+  { YFIELD_##t, k, { offsetof(struct YQuote, pre), offsetof(struct YQuote, regular), offsetof(struct YQuote, post) } }
+#define YTICK(t, n) YTICK_SESSION(t, 1, n, n, n)
+
+#define YTICK_ID           1
+#define YTICK_MARKET_HOURS 7
+#define YTICK_FIELDS       27
+
+static const struct YTickField ytick_fields[YTICK_FIELDS] = {
+  [2]  = YTICK_SESSION(DOUBLE, 1, preMarketPrice, regularMarketPrice, postMarketPrice),
+  [3]  = YTICK_SESSION(INT, 1000, preMarketTime, regularMarketTime, postMarketTime), /* milliseconds */
+  [8]  = YTICK_SESSION(DOUBLE, 1, preMarketChangePercent, regularMarketChangePercent, postMarketChangePercent),
+  [9]  = YTICK(INT, regularMarketVolume),
+  [10] = YTICK(DOUBLE, regularMarketDayHigh),
+  [11] = YTICK(DOUBLE, regularMarketDayLow),
+  [12] = YTICK_SESSION(DOUBLE, 1, preMarketChange, regularMarketChange, postMarketChange),
+  [15] = YTICK(DOUBLE, regularMarketOpen),
+  [16] = YTICK(DOUBLE, regularMarketPreviousClose),
+  [23] = YTICK(DOUBLE, bid),
+  [24] = YTICK(INT, bidSize),
+  [25] = YTICK(DOUBLE, ask),
+  [26] = YTICK(INT, askSize),
+};
+
+/* marketHours: PRE_MARKET, REGULAR_MARKET, POST_MARKET, EXTENDED_HOURS_MARKET */
+static const char * const ytick_states[] = { "PRE", "REGULAR", "POST", "POSTPOST" };
+static const size_t ytick_sessions[] = { 0, 1, 2, 2 };
+
+struct YTickWire
+{
+  unsigned     number;
+  unsigned     type;  /*< 0 varint, 1 fixed64, 2 length-delimited, 5 fixed32 */
+  uint64_t     value; /*< varint or fixed bits */
+  const uchar *data;  /*< length-delimited bytes */
+  size_t       size;
+};
+
+static const uchar *ytick_varint(const uchar *p, const uchar *end, uint64_t *v)
+{
+  *v = 0;
+  for (int shift = 0; p < end && shift < 64; shift += 7) {
+    uchar b = *p++;
+    *v |= (uint64_t) (b & 0x7f) << shift;
+    if (!(b & 0x80)) {
+      return p;
+    }
+  }
+  return NULL;
+}
+
+static uint64_t ytick_fixed(const uchar *p, int n)
+{
+  uint64_t v = 0;
+  while (n--) {
+    v = v << 8 | p[n];
+  }
+  return v;
+}
+
+/* Reads the field at p into w; returns the next field, or NULL if malformed */
+static const uchar *ytick_next(const uchar *p, const uchar *end, struct YTickWire *w)
+{
+  uint64_t key;
+  if (!(p = ytick_varint(p, end, &key))) {
+    return NULL;
+  }
+  w->number = key >> 3, w->type = key & 7;
+  switch (w->type) {
+  case 0:
+    return ytick_varint(p, end, &w->value);
+  case 1:
+  case 5: {
+    int n = w->type == 1 ? 8 : 4;
+    if (end - p < n) {
+      return NULL;
+    }
+    w->value = ytick_fixed(p, n);
+    return p + n;
+  }
+  case 2:
+    if (!(p = ytick_varint(p, end, &w->value)) || w->value > (uint64_t) (end - p)) {
+      return NULL;
+    }
+    w->data = p, w->size = w->value;
+    return p + w->size;
+  default:
+    return NULL;
+  }
+}
+
+/*
+ * Applies the fields present in a PricingData message to the cached quote
+ * of its symbol.  Returns 1 if a quote changed, 0 if the symbol is not
+ * subscribed or not cached yet, or the message is malformed.
+ */
+static int ytick_apply(const uchar *data, size_t size)
+{
+  const uchar *end = data + size;
+  struct YTickWire w;
+  YString id = "";
+  uint64_t hours = 0; /* absent is PRE_MARKET, proto3 omits zeros */
+  for (const uchar *p = data; p < end; ) {
+    if (!(p = ytick_next(p, end, &w))) {
+      return 0;
+    }
+    if (w.number == YTICK_ID && w.type == 2) {
+      size_t n = MIN(w.size, YSTRING_LENGTH);
+      memcpy(id, w.data, n);
+      id[n] = 0;
+    } else if (w.number == YTICK_MARKET_HOURS && w.type == 0) {
+      hours = w.value;
+    }
+  }
+
+  struct YQuote *q = g_hash_table_contains(ystream.symbols, id) ? g_hash_table_lookup(yql_quotes, id) : NULL;
+  if (!q || hours >= G_N_ELEMENTS(ytick_states)) {
+    return 0;
+  }
+
+  size_t session = ytick_sessions[hours];
+  for (const uchar *p = data; p < end; ) {
+    p = ytick_next(p, end, &w);
+    if (w.number >= YTICK_FIELDS || !ytick_fields[w.number].scale) {
+      continue;
+    }
+    const struct YTickField *f = &ytick_fields[w.number];
+    void *v = (char *) q + f->offset[session];
+    if (f->type == YFIELD_DOUBLE && w.type == 5) {
+      union { uint32_t u; float f; } x = { .u = w.value };
+      *(double *) v = x.f;
+    } else if (f->type == YFIELD_DOUBLE && w.type == 1) {
+      union { uint64_t u; double d; } x = { .u = w.value };
+      *(double *) v = x.d;
+    } else if (f->type == YFIELD_INT && w.type == 0) {
+      int64_t i = (int64_t) (w.value >> 1) ^ -(int64_t) (w.value & 1); /* sint64 */
+      *(int64_t *) v = i / f->scale;
+    }
+  }
+  YString_copy(q->marketState, ytick_states[hours]);
+  return 1;
+}
+
+struct YStreamEnvelope
+{
+  char *message;
+  bool  key;
+};
+
+static int yql_stream_envelope(void *u, enum JStreamEvent e, const char *s, size_t n)
+{
+  struct YStreamEnvelope *x = u;
+  if (e == JSTREAM_STRING && x->key) {
+    memcpy(x->message, s, n + 1);
+  }
+  x->key = e == JSTREAM_KEY && strcmp(s, "message") == 0;
+  return 0;
+}
+
+/*
+ * Applies one message: the base64 PricingData alone, or wrapped in the v2
+ * envelope {"type":"pricing","message":"..."}.  s has room for s[n] = 0.
+ */
+static int yql_stream_message(char *s, size_t n)
+{
+  while (n > 0 && g_ascii_isspace(s[n - 1])) {
+    n--;
+  }
+  s[n] = 0;
+
+  char message[JSTREAM_TOKEN_LENGTH + 1] = "";
+  if (s[0] == '{') {
+    struct YStreamEnvelope e = { message, false };
+    struct JStream j;
+    jstream_init(&j, yql_stream_envelope, &e);
+    if (jstream_feed(&j, s, n) != JSTREAM_OK || jstream_end(&j) != JSTREAM_OK) {
+      log_warn(logger, "yql_stream_message(): %s\n", s);
+      return 0;
+    }
+    s = message;
+  }
+
+  gsize size = 0;
+  const guchar *data = g_base64_decode_inplace(s, &size);
+  return ytick_apply(data, size);
+}
+
+static void yql_stream_disconnect()
+{
+  if (ystream.easy) {
+    curl_multi_remove_handle(ystream.multi, ystream.easy);
+    curl_easy_cleanup(ystream.easy);        ystream.easy = NULL;
+  }
+  ystream.connected = false;
+  ystream.length = 0, ystream.skip = false;
+  ystream.retry = g_get_monotonic_time() + ystream.backoff;
+  ystream.backoff = MIN(ystream.backoff * 2, YSTREAM_BACKOFF_MAX);
+}
+
+/* Sends {"subscribe":[...]} or {"unsubscribe":[...]} */
+static int yql_stream_send(const char *verb, const char * const *symbols, size_t n)
+{
+  if (!ystream.connected || n == 0) {
+    return YERROR_NERR;
+  }
+
+  GString *s = g_string_new(NULL);
+  g_string_append_printf(s, "{\"%s\":[", verb);
+  for (size_t i = 0; i < n; i++) {
+    g_string_append_printf(s, "%s\"%s\"", i ? "," : "", symbols[i]);
+  }
+  g_string_append(s, "]}");
+
+  size_t sent = 0;
+  CURLcode code = curl_ws_send(ystream.easy, s->str, s->len, &sent, 0, CURLWS_TEXT);
+  g_string_free(s, TRUE);
+  if (code != CURLE_OK) {
+    log_warn(logger, "curl_ws_send(%s): %s\n", verb, curl_easy_strerror(code));
+    yql_stream_disconnect();
+    return YERROR_CURL;
+  }
+  return YERROR_NERR;
+}
+
+static int yql_stream_send_all(const char *verb, GHashTable *symbols)
+{
+  guint n = 0;
+  const char **x = (const char **) g_hash_table_get_keys_as_array(symbols, &n);
+  int status = yql_stream_send(verb, x, n);
+  g_free(x);
+  return status;
+}
+
+/*
+ * Starts connecting once something is subscribed, and again after a
+ * failure once the backoff has elapsed.  The upgrade is progressed by
+ * yql_stream_upgrade(), so a slow streamer never stalls the caller.
+ */
+static void yql_stream_connect()
+{
+  if (g_hash_table_size(ystream.symbols) == 0 || g_get_monotonic_time() < ystream.retry) {
+    return;
+  }
+
+  CURL *easy = http_easy_init();
+  if (!easy) {
+    yql_stream_disconnect();
+    return;
+  }
+  curl_easy_setopt(easy, CURLOPT_URL, ystream.source);
+  curl_easy_setopt(easy, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+  curl_easy_setopt(easy, CURLOPT_CONNECT_ONLY, 2L); /* websocket upgrade, then curl_ws_*() */
+  curl_easy_setopt(easy, CURLOPT_TIMEOUT_MS, YSTREAM_TIMEOUT);
+  CURLMcode code = curl_multi_add_handle(ystream.multi, easy);
+  ystream.easy = easy, ystream.connected = false;
+  if (code != CURLM_OK) {
+    log_warn(logger, "curl_multi_add_handle(%s): %s\n", ystream.source, curl_multi_strerror(code));
+    yql_stream_disconnect();
+  }
+}
+
+/* Progresses the upgrade, sending the whole subscription once it is done */
+static void yql_stream_upgrade()
+{
+  int running = 0, n = 0;
+  CURLMcode mcode = curl_multi_perform(ystream.multi, &running);
+  if (mcode != CURLM_OK) {
+    log_warn(logger, "curl_multi_perform(%s): %s\n", ystream.source, curl_multi_strerror(mcode));
+    yql_stream_disconnect();
+    return;
+  }
+
+  CURLMsg *msg = NULL;
+  while (ystream.easy && !ystream.connected && (msg = curl_multi_info_read(ystream.multi, &n))) {
+    if (msg->msg != CURLMSG_DONE) {
+      continue;
+    }
+    /* easy stays added: curl_ws_*() find its connection through the multi handle */
+    if (msg->data.result != CURLE_OK) {
+      log_warn(logger, "yql_stream_upgrade(%s): %s\n", ystream.source, curl_easy_strerror(msg->data.result));
+      yql_stream_disconnect();
+      return;
+    }
+    ystream.connected = true;
+    log_debug(logger, "yql_stream_upgrade(): %s\n", ystream.source);
+    yql_stream_send_all("subscribe", ystream.symbols);
+  }
+}
+
+static int yql_stream_read_websocket()
+{
+  int applied = 0;
+  for (int messages = 0; ystream.connected && messages < YSTREAM_MESSAGES; ) {
+    size_t n = 0;
+    struct curl_ws_frame *meta = NULL;
+    CURLcode code = curl_ws_recv(ystream.easy, ystream.buffer + ystream.length, YSTREAM_LENGTH - ystream.length, &n, &meta);
+    if (code == CURLE_AGAIN) {
+      break;
+    }
+    if (code != CURLE_OK || meta->flags & CURLWS_CLOSE) {
+      log_warn(logger, "curl_ws_recv(): %s\n", code != CURLE_OK ? curl_easy_strerror(code) : "closed");
+      yql_stream_disconnect();
+      break;
+    }
+    if (meta->flags & (CURLWS_PING | CURLWS_PONG)) {
+      continue; /* answered by libcurl */
+    }
+
+    ystream.length += n;
+    bool more = meta->bytesleft > 0 || meta->flags & CURLWS_CONT;
+    if (more) {
+      if (ystream.length == YSTREAM_LENGTH) {
+        ystream.length = 0, ystream.skip = true;
+      }
+      continue;
+    }
+    if (!ystream.skip) {
+      if (ystream.record) {
+        fprintf(ystream.record, "%.*s\n", (int) ystream.length, ystream.buffer);
+      }
+      applied += yql_stream_message(ystream.buffer, ystream.length);
+    }
+    ystream.length = 0, ystream.skip = false;
+    ystream.backoff = YSTREAM_BACKOFF; /* the connection works */
+    messages++;
+  }
+  return applied;
+}
+
+static int yql_stream_read_file()
+{
+  int applied = 0, messages = 0;
+  while (messages < YSTREAM_MESSAGES) {
+    char *eol = memchr(ystream.buffer, '\n', ystream.length);
+    if (eol) {
+      size_t n = eol - ystream.buffer;
+      if (!ystream.skip) {
+        applied += yql_stream_message(ystream.buffer, n);
+      }
+      ystream.length -= n + 1, ystream.skip = false;
+      memmove(ystream.buffer, eol + 1, ystream.length);
+      messages++;
+      continue;
+    }
+    if (ystream.length == YSTREAM_LENGTH) {
+      ystream.length = 0, ystream.skip = true;
+    }
+    /* A FIFO without a writer reads as end of file, so keep the source open */
+    ssize_t n = read(ystream.fd, ystream.buffer + ystream.length, YSTREAM_LENGTH - ystream.length);
+    if (n <= 0) {
+      if (n < 0 && errno != EAGAIN) {
+        log_warn(logger, "read(%s): %s\n", ystream.source, strerror(errno));
+      }
+      break;
+    }
+    ystream.length += n;
+  }
+  return applied;
+}
+
+static int yql_stream_poll()
+{
+  switch (ystream.kind) {
+  case YSTREAM_WEBSOCKET:
+    if (!ystream.easy) {
+      yql_stream_connect();
+    }
+    if (ystream.easy && !ystream.connected) {
+      yql_stream_upgrade();
+    }
+    return yql_stream_read_websocket();
+  case YSTREAM_FILE:
+    return yql_stream_read_file();
+  default:
+    return 0;
+  }
+}
+
+/**
+ * Starts streaming quotes from source: a ws:// or wss:// streamer, or a
+ * file:// of messages to replay, which may be a FIFO.  NULL takes the
+ * source from YSTREAM_ENV, defaulting to Y_STREAMER unless responses are
+ * served by an origin or a replay; "off" disables streaming.  Nothing is
+ * read until symbols are subscribed, and updates land in yql_poll().
+ */
+int yql_stream_open(const char *source)
+{
+  yql_stream_close();
+  if (!source) {
+    source = getenv(YSTREAM_ENV);
+  }
+  if (!source) {
+    source = getenv(HTTP_ORIGIN_ENV) || getenv(HTTP_REPLAY_ENV) ? "off" : Y_STREAMER;
+  }
+
+  if (g_str_has_prefix(source, "file://")) {
+    const char *path = source + strlen("file://");
+    ystream.fd = open(path, O_RDONLY | O_NONBLOCK);
+    if (ystream.fd < 0) {
+      log_error(logger, "open(%s): %s\n", path, strerror(errno));
+      return YERROR_CERR;
+    }
+    ystream.kind = YSTREAM_FILE;
+  } else if (g_str_has_prefix(source, "ws://") || g_str_has_prefix(source, "wss://")) {
+    const char *record = getenv(HTTP_REPLAY_ENV) ? NULL : getenv(HTTP_RECORD_ENV);
+    if (record) {
+      char path[HTTP_PATH_LENGTH + 1];
+      snprintf(path, sizeof(path), "%s/stream", record);
+      ystream.record = fopen(path, "a");
+      if (!ystream.record) {
+        log_warn(logger, "fopen(%s): %s\n", path, strerror(errno));
+      } else {
+        setvbuf(ystream.record, NULL, _IOLBF, 0);
+      }
+    }
+    ystream.multi = http_multi_init();
+    if (!ystream.multi) {
+      return YERROR_CURL;
+    }
+    ystream.kind = YSTREAM_WEBSOCKET;
+  } else {
+    if (strcmp(source, "off") != 0) {
+      log_error(logger, "yql_stream_open(%s): unknown source\n", source);
+      return YERROR_CERR;
+    }
+    return YERROR_NERR;
+  }
+
+  ystream.source = strdup(source);
+  ystream.symbols = g_hash_table_new_full(g_str_hash, g_str_equal, free, NULL);
+  ystream.retry = 0, ystream.backoff = YSTREAM_BACKOFF;
+  log_debug(logger, "yql_stream_open(): %s\n", source);
+  return YERROR_NERR;
+}
+
+void yql_stream_close()
+{
+  yql_stream_disconnect();
+  if (ystream.multi) {
+    curl_multi_cleanup(ystream.multi);      ystream.multi = NULL;
+  }
+  if (ystream.fd >= 0) {
+    close(ystream.fd);                      ystream.fd = -1;
+  }
+  if (ystream.record) {
+    fclose(ystream.record);                 ystream.record = NULL;
+  }
+  if (ystream.symbols) {
+    g_hash_table_destroy(ystream.symbols);  ystream.symbols = NULL;
+  }
+  free(ystream.source);                     ystream.source = NULL;
+  ystream.kind = YSTREAM_NONE;
+  ystream.length = 0, ystream.skip = false;
+}
+
+/**
+ * Streams exactly these symbols from now on: those no longer wanted are
+ * unsubscribed and only the new ones subscribed, so moving between panels
+ * costs one small message rather than a request per symbol.  Quotes
+ * update once yql_quote() has cached them.
+ */
+int yql_stream_subscribe(const char **symbols, size_t n)
+{
+  if (ystream.kind == YSTREAM_NONE) {
+    return YERROR_NERR;
+  }
+
+  GHashTable *next = g_hash_table_new_full(g_str_hash, g_str_equal, free, NULL);
+  GPtrArray *added = g_ptr_array_new();
+  for (size_t i = 0; i < n; i++) {
+    if (!symbols[i] || !symbols[i][0] || g_hash_table_contains(next, symbols[i])) {
+      continue;
+    }
+    g_hash_table_add(next, strdup(symbols[i]));
+    if (!g_hash_table_remove(ystream.symbols, symbols[i])) {
+      g_ptr_array_add(added, (gpointer) symbols[i]);
+    }
+  }
+
+  int status = yql_stream_send_all("unsubscribe", ystream.symbols);
+  if (status == YERROR_NERR) {
+    status = yql_stream_send("subscribe", (const char * const *) added->pdata, added->len);
+  }
+  g_ptr_array_free(added, TRUE);
+  g_hash_table_destroy(ystream.symbols);
+  ystream.symbols = next;
+  return status;
+}
+
+/**
+ * Progresses background revalidations without blocking, parsing whatever
+ * completed into the caches, and applies the quotes streamed since.
+ * Returns the number of responses that landed and quotes that changed, so
+ * the caller knows when to repaint.
+ */
+int yql_poll(int (*done)(int, const char *))
+{
+  int ticks = yql_stream_poll();
+  if (!revalidate.handle || revalidate.requests->len == 0) {
+    return ticks;
+  }
+
+  int running = 0;
+  guint n = revalidate.requests->len;
+  int status = YERROR_NERR;
+  yql_multi_launch(&revalidate, done, &status);
+  CURLMcode code = curl_multi_perform(revalidate.handle, &running);
+  if (code != CURLM_OK) {
+    log_error(logger, "curl_multi_perform(): %s\n", curl_multi_strerror(code));
+    yql_multi_abort(&revalidate);
+    return ticks;
+  }
+  yql_multi_read(&revalidate, done, YERROR_NERR);
+  return ticks + n - revalidate.requests->len;
+}
+
+/**
+ * Forgets when every cached response was fetched, so the next request for
+ * each is performed again instead of served from the caches.
+ */
+void yql_invalidate()
+{
+  int64_t never = INT64_MAX;
+  pthread_mutex_lock(&stamp_lock);
+  g_hash_table_remove_all(yql_stamps);
+  pthread_mutex_unlock(&stamp_lock);
+  pthread_mutex_lock(&flight_lock);
+  g_hash_table_foreach_remove(yql_flights, yql_flight_expired, &never);
+  pthread_mutex_unlock(&flight_lock);
+}
+
+/**
+ * alias, if not NULL, is the URL whose cache entry the request refreshes,
+ * for requests that update a cached response rather than replace it.
+ */
+static int yql_perform(const char *url, const char *alias, const char *symbol, const struct YFormat *format)
+{
+  int status = yql_multi_begin();
+  if (status != YERROR_NERR) {
+    return status;
+  }
+  status = yql_request(&multi, url, alias, symbol, format, NULL);
+  int rstatus = yql_multi_end(NULL);
+  return status != YERROR_NERR ? status : rstatus;
 }
 
 static int yql_query(const char *url, const char *symbol)
 {
   log_debug(logger, "yql_query(%s)\n", url);
 
-  curl_easy_setopt(easy, CURLOPT_URL, url);
-  curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, callback);
-  struct JsonBuffer buffer = { .data = NULL, .size = 0 };
-  curl_easy_setopt(easy, CURLOPT_WRITEDATA, &buffer);
-  curl_easy_perform(easy);
-
-  int status = json_parse(&buffer, symbol);
-  free(buffer.data);
-  return status;
+  return yql_perform(url, NULL, symbol, &json_format);
 }
 
 static char *yql_vasprintf(const char *fmt, va_list ap)
@@ -1025,10 +3254,12 @@ static int yql_vaquery(const char *fmt, ...)
   va_list ap;
   va_start(ap, fmt);
 
-  char *url = yql_vasprintf(fmt, ap);
+  struct YArena a = { .head = NULL };
+  char *url = YArena_vsprintf(&a, fmt, ap);
   va_end(ap);
   if (!url) {
-    log_error(logger, "yql_vasprintf(%s)\n", fmt);
+    log_error(logger, "YArena_vsprintf(%s)\n", fmt);
+    YArena_reset(&a);
     return YERROR_CERR;
   }
 
@@ -1037,7 +3268,7 @@ static int yql_vaquery(const char *fmt, ...)
   va_end(ap);
 
   int status = yql_query(url, symbol);
-  free(url);
+  YArena_reset(&a);
   return status;
 }
 
@@ -1046,42 +3277,153 @@ int yql_quote(const char *s)
   return yql_vaquery(Y_QUOTE "?symbols=%s", s);
 }
 
-int yql_quoteSummary(const char *s)
+/**
+ * Symbols are deduplicated and joined into as few requests as fit within
+ * YURL_LENGTH bytes and max symbols each; the chunks are fetched
+ * concurrently and merged into the cache by the response parser.
+ */
+static int yql_batch(const char *prefix, const char *suffix, size_t max, const char **symbols, size_t n)
 {
-  return yql_vaquery(Y_QUOTESUMMARY "/%s" "?modules=assetProfile,defaultKeyStatistics,financialData", s);
-}
+  int status = yql_multi_begin();
+  if (status != YERROR_NERR) {
+    return status;
+  }
 
-int yql_earnings(const char *s)
-{
-  /* modules=indexTrend,industryTrend,sectorTrend */
-  return yql_vaquery(Y_QUOTESUMMARY "/%s" "?modules=calendarEvents,earnings,earningsHistory,earningsTrend", s);
+  GHashTable *seen = g_hash_table_new(g_str_hash, g_str_equal);
+  GString *url = g_string_sized_new(YURL_LENGTH);
+  const char *first = NULL;
+  size_t m = 0, slen = strlen(suffix);
+  for (size_t i = 0; i <= n; i++) {
+    const char *s = i < n ? symbols[i] : NULL;
+    size_t len = s ? strnlen(s, YSTRING_LENGTH) : 0;
+    if (s && (!len || !g_hash_table_add(seen, (char *) s))) {
+      continue;
+    }
+    if (first && (!s || m == max || url->len + 1 + len + slen > YURL_LENGTH)) {
+      g_string_append(url, suffix);
+      int qstatus = yql_query(url->str, first); /* a failed chunk does not hold back the rest */
+      if (status == YERROR_NERR) {
+        status = qstatus;
+      }
+      first = NULL;
+    }
+    if (s) {
+      if (!first) {
+        g_string_assign(url, prefix);
+        first = s, m = 0;
+      } else {
+        g_string_append_c(url, ',');
+      }
+      g_string_append_len(url, s, len);
+      m++;
+    }
+  }
+  g_string_free(url, TRUE);
+  g_hash_table_destroy(seen);
+
+  int rstatus = yql_multi_end(NULL);
+  return status != YERROR_NERR ? status : rstatus;
 }
 
-int yql_financials(const char *s)
+/**
+ * fields is a comma-separated projection of struct YQuote members, or NULL
+ * for the full quote.  Members left out keep their previously cached value.
+ */
+int yql_quote_batch(const char **symbols, size_t n, const char *fields)
 {
-  return yql_vaquery(Y_QUOTESUMMARY "/%s" "?modules="
-                     "balanceSheetHistory,balanceSheetHistoryQuarterly,"
-                     "cashflowStatementHistory,cashflowStatementHistoryQuarterly,"
-                     "incomeStatementHistory,incomeStatementHistoryQuarterly",
-                     s);
+  if (!fields) {
+    return yql_batch(Y_QUOTE "?symbols=", "", SIZE_MAX, symbols, n);
+  }
+
+  char *suffix = yql_asprintf("&fields=symbol,%s", fields);
+  if (!suffix) {
+    log_error(logger, "yql_asprintf(%s)\n", fields);
+    return YERROR_CERR;
+  }
+  int status = yql_batch(Y_QUOTE "?symbols=", suffix, SIZE_MAX, symbols, n);
+  free(suffix);
+  return status;
 }
 
-int yql_holdings(const char *s)
+/**
+ * Fetches the modules set in the YModule mask in one request and merges
+ * them into the cached summary; sections not requested keep their values.
+ */
+int yql_quoteSummary(const char *s, unsigned modules)
 {
-  return yql_vaquery(Y_QUOTESUMMARY "/%s" "?modules=topHoldings", s);
+  static const char * const names[YMODULES] = {
+    "assetProfile", "calendarEvents", "defaultKeyStatistics", "earnings",
+    "earningsHistory", "earningsTrend", "financialData", "topHoldings",
+  };
+
+  if (!modules) {
+    return YERROR_NERR;
+  }
+
+  GString *m = g_string_new(NULL);
+  for (int i = 0; i < YMODULES; i++) {
+    if (modules & (1u << i)) {
+      g_string_append_printf(m, "%s%s", m->len ? "," : "", names[i]);
+    }
+  }
+  int status = yql_vaquery(Y_QUOTESUMMARY "/%s" "?modules=%s", s, m->str);
+  g_string_free(m, TRUE);
+  return status;
 }
 
 /**
  * interval := [ "2m", "1d", "1wk", "1mo" ]
  * range    := [ "1d", "5d", "1mo", "3mo", "6mo", "1y", "2y", "5y", "10y", "ytd", "max" ]
  */
+#define YCHART_URL(a, s, range, interval)                                 \
+  YArena_sprintf(a, Y_CHART "/%s?symbol=%s" "&range=%s" "&interval=%s"    \
+                 "&events=capitalGain|div|earn|split" "&includeAdjustedClose=true" "&includePrePost=true", \
+                 s, s, range, interval)
+
 int yql_chart(const char *s)
 {
   const char *range = "3mo", *interval = "1d";
 
-  return yql_vaquery(Y_CHART "/%s?symbol=%s" "&range=%s" "&interval=%s"
-                     "&events=capitalGain|div|earn|split" "&includeAdjustedClose=true" "&includePrePost=true",
-                     s, s, range, interval);
+  struct YArena a = { .head = NULL };
+  char *url = YCHART_URL(&a, s, range, interval);
+  int status = YERROR_CERR;
+  if (url) {
+    status = yql_query(url, s);
+  } else {
+    log_error(logger, "YArena_sprintf(%s)\n", Y_CHART);
+  }
+  YArena_reset(&a);
+  return status;
+}
+
+/**
+ * Refreshes a cached yql_chart with only the bars since its last timestamp,
+ * merged in place; falls back to yql_chart when nothing is cached yet or
+ * only a close-only yql_spark series is.
+ */
+int yql_chart_update(const char *s)
+{
+  const char *range = "3mo", *interval = "1d";
+
+  const struct YChart * const c = yql_chart_get(s);
+  if (!c || !c->count || c->closeOnly) {
+    return yql_chart(s);
+  }
+
+  struct YArena a = { .head = NULL };
+  char *alias = YCHART_URL(&a, s, range, interval);
+  char *url = YArena_sprintf(&a, Y_CHART "/%s?symbol=%s" "&period1=%ld" "&period2=%ld" "&interval=%s"
+                             "&events=capitalGain|div|earn|split" "&includeAdjustedClose=true" "&includePrePost=true",
+                             s, s, (long) c->timestamp[c->count - 1], (long) time(NULL), interval);
+  int status = YERROR_CERR;
+  if (alias && url) {
+    log_debug(logger, "yql_query(%s)\n", url);
+    status = yql_perform(url, alias, s, &merge_format);
+  } else {
+    log_error(logger, "YArena_sprintf(%s)\n", Y_CHART);
+  }
+  YArena_reset(&a);
+  return status;
 }
 
 int yql_chart_range(const char *s, time_t period1, time_t period2, const char *interval)
@@ -1091,6 +3433,19 @@ int yql_chart_range(const char *s, time_t period1, time_t period2, const char *i
                      s, s, period1, period2, interval);
 }
 
+/**
+ * Close-only series over the same range and interval as yql_chart, for up
+ * to YSPARK_SYMBOLS symbols per request.
+ */
+int yql_spark(const char **symbols, size_t n)
+{
+  const char *range = "3mo", *interval = "1d";
+
+  char suffix[YSTRING_LENGTH + 1];
+  snprintf(suffix, sizeof(suffix), "&range=%s" "&interval=%s", range, interval);
+  return yql_batch(Y_SPARK "?symbols=", suffix, YSPARK_SYMBOLS, symbols, n);
+}
+
 int yql_options(const char *s)
 {
   return yql_vaquery(Y_OPTIONS "/%s" "?straddle=false", s);
@@ -1110,17 +3465,28 @@ int yql_options_series_k(const char *s, double strike)
  * interval := [ "1d", "1wk", "1mo" ]
  * events   := [ "capitalGain", "div", "history", "split" ]
  */
-static int yql_download(const char *s, time_t period1, time_t period2, const char *interval, const char *events)
+#define YDOWNLOAD_URL(s, period1, period2, interval, events)                                                    \
+  yql_asprintf(Y_DOWNLOAD "/%s" "?period1=%ld" "&period2=%ld" "&interval=%s" "&events=%s" "&includeAdjustedClose=true", \
+               s, period1, period2, interval, events)
+
+static int yql_download(const char *s, time_t period1, time_t period2, const char *interval, const char *events,
+                        curl_write_callback write, void *data)
 {
-  char *url = yql_asprintf(Y_DOWNLOAD "/%s" "?period1=%ld" "&period2=%ld" "&interval=%s" "&events=%s" "&includeAdjustedClose=true",
-                           s, period1, period2, interval, events);
+  char *url = YDOWNLOAD_URL(s, period1, period2, interval, events);
   if (!url) {
     log_error(logger, "yql_asprintf(%s)\n", Y_DOWNLOAD);
     return YERROR_CERR;
   }
 
-  curl_easy_setopt(easy, CURLOPT_URL, url);
+  yql_route(url);
+  if (http_wait(url) != HTTP_OK) {
+    free(url);
+    return YERROR_CURL;
+  }
+  http_prepare(easy, url, write, data);
   CURLcode status = curl_easy_perform(easy);
+  http_drain_wait(easy);
+  http_report(url, easy, status);
   if (status != CURLE_OK) {
     log_warn(logger, "curl_easy_perform(%s): %s\n", url, curl_easy_strerror(status));
     free(url);
@@ -1150,69 +3516,222 @@ int yql_download_r(const char *s, time_t period1, time_t period2, const char *in
 {
   const char *events = "history";
 
-  curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, callback);
-  struct JsonBuffer buffer = { .data = NULL, .size = 0 };
-  curl_easy_setopt(easy, CURLOPT_WRITEDATA, &buffer);
+  struct HttpBuffer buffer = { .data = NULL, .size = 0, .capacity = 0 };
 
-  int status = yql_download(s, period1, period2, interval, events);
+  int status = yql_download(s, period1, period2, interval, events, http_buffer_write, &buffer);
   status = yql_download_e(status, buffer.data, buffer.size);
   if (status == YERROR_NERR) {
-    *data = buffer.data, *size = buffer.size;
+    *size = buffer.size, *data = http_buffer_detach(&buffer);
   } else {
-    free(buffer.data);
+    http_buffer_release(&buffer);
   }
   return status;
 }
 
-static int csv_history(const char *s, const char *data, size_t size, YArray *A)
+/**
+ * Field parsers for history rows.  They do not depend on the locale, which
+ * gammaterm sets from the environment, and return the end of the field or
+ * NULL if it is malformed.
+ */
+/* Powers of ten exactly representable as doubles */
+static const double csv_pow10[] = {
+  1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+static const char *csv_date(const char *p, char *v)
 {
-  size_t i = 0;
-  while (i < size && data[i++] != 0x0A); /* Skip CSV header */
+  size_t n = 0;
+  while (n < YDATE_LENGTH && ((p[n] >= '0' && p[n] <= '9') || p[n] == '-')) {
+    v[n] = p[n];
+    n++;
+  }
+  v[n] = '\0';
+  return n ? p + n : NULL;
+}
 
-  const char *format = YDATE_IFORMAT ",%lf,%lf,%lf,%lf,%lf,%ld\n%n";
-  for (int m = 0, n = 0; i < size; i += n) {
-    if (A->length >= A->capacity) {
-      int status = YArray_resize(A, sizeof(struct YHistory));
-      if (status != YERROR_NERR) {
-        return status;
+/**
+ * A mantissa of up to 19 digits is accumulated as an integer; when it fits
+ * in 53 bits and the exponent is within the table, one multiplication or
+ * division by an exact power of ten is correctly rounded.  Anything else
+ * falls back to strtod() in the "C" locale.
+ */
+static const char *csv_double(const char *p, double *v)
+{
+  const char *s = p;
+  bool negative = *p == '-';
+  p += negative || *p == '+';
+
+  uint64_t m = 0;
+  int digits = 0, exponent = 0;
+  bool exact = true;
+  const char *q = p;
+  for ( ; *p >= '0' && *p <= '9'; p++) {
+    if (digits < 19) {
+      m = m * 10 + (*p - '0'), digits += m > 0;
+    } else {
+      exponent++, exact &= *p == '0';
+    }
+  }
+  if (*p == '.') {
+    for (p++; *p >= '0' && *p <= '9'; p++) {
+      if (digits < 19) {
+        m = m * 10 + (*p - '0'), digits += m > 0, exponent--;
+      } else {
+        exact &= *p == '0';
       }
     }
-    struct YHistory *h = YArray_index(A, struct YHistory, A->length);
-    h->symbol = s;
+  }
+  if (p == q || (p == q + 1 && *q == '.')) {
+    return NULL;
+  }
+  if (*p == 'e' || *p == 'E') {
+    exact = false;
+  }
 
-    m = sscanf(data + i, format, h->date, &h->open, &h->high, &h->low, &h->close, &h->adjclose, &h->volume, &n);
-    if (m < 7) {
-      log_warn(logger, "sscanf(%s, %zu)\n", s, i);
-      return YERROR_JSON;
-    }
+  if (exact && m <= (UINT64_C(1) << 53) && exponent >= -22 && exponent <= 22) {
+    double d = (double) m;
+    d = exponent < 0 ? d / csv_pow10[-exponent] : d * csv_pow10[exponent];
+    *v = negative ? -d : d;
+    return p;
+  }
+  char *end = NULL;
+  locale_t locale = uselocale(csv_locale);
+  *v = strtod(s, &end);
+  uselocale(locale);
+  return end != s ? end : NULL;
+}
+
+static const char *csv_int(const char *p, int64_t *v)
+{
+  bool negative = *p == '-';
+  const char *q = p += negative;
+  int64_t n = 0;
+  for ( ; *p >= '0' && *p <= '9'; p++) {
+    n = n * 10 + (*p - '0');
+  }
+  if (p == q) {
+    return NULL;
+  }
+  *v = negative ? -n : n;
+  return p;
+}
 
-    A->length++;
+static int csv_history(const char *s, const char *line, YArray *A)
+{
+  if (A->length >= A->capacity) {
+    int status = YArray_resize(A, sizeof(struct YHistory));
+    if (status != YERROR_NERR) {
+      return status;
+    }
+  }
+  struct YHistory *h = YArray_index(A, struct YHistory, A->length);
+  h->symbol = s;
+
+  /* Date,Open,High,Low,Close,Adj Close,Volume */
+  double *columns[] = { &h->open, &h->high, &h->low, &h->close, &h->adjclose };
+  const char *p = csv_date(line, h->date);
+  for (size_t i = 0; i < sizeof(columns) / sizeof(columns[0]); i++) {
+    p = p && *p == ',' ? csv_double(p + 1, columns[i]) : NULL;
+  }
+  p = p && *p == ',' ? csv_int(p + 1, &h->volume) : NULL;
+  if (!p || *p) {
+    /* Days without trading come as a row of nulls */
+    if (strstr(line, "null")) {
+      log_debug(logger, "csv_history(%s, %zu): %s\n", s, A->length, line);
+      return YERROR_NERR;
+    }
+    log_warn(logger, "csv_history(%s, %zu): %s\n", s, A->length, line);
+    return YERROR_JSON;
   }
 
+  A->length++;
   return YERROR_NERR;
 }
 
+/**
+ * History rows are parsed line by line as chunks arrive; only a partial
+ * line is carried between chunks.  The first line is kept for
+ * yql_download_e, since an error body replaces the CSV header.
+ */
+struct CsvStream
+{
+  const char *symbol;
+  YArray     *A;
+  int         status;
+  size_t      lines;
+  size_t      len;
+  char        line[YCSV_LINE_LENGTH + 1];
+  char        head[YTEXT_LENGTH + 1];
+};
+
+static void csv_flush(struct CsvStream *c)
+{
+  if (c->len && c->line[c->len - 1] == '\r') {
+    c->len--;
+  }
+  c->line[c->len] = 0;
+  if (c->lines++ == 0) {
+    strncpy(c->head, c->line, YTEXT_LENGTH);
+  } else if (c->len && c->status == YERROR_NERR) {
+    c->status = csv_history(c->symbol, c->line, c->A);
+  }
+  c->len = 0;
+}
+
+static size_t csv_write(char *p, size_t size, size_t nmemb, void *user)
+{
+  struct CsvStream *c = user;
+  size_t nsize = size * nmemb;
+  for (const char *q = p, *end = p + nsize; q < end; ) {
+    const char *nl = memchr(q, '\n', end - q);
+    size_t k = (nl ? nl : end) - q;
+    if (k > YCSV_LINE_LENGTH - c->len) {
+      k = YCSV_LINE_LENGTH - c->len;
+    }
+    memcpy(c->line + c->len, q, k);
+    c->len += k;
+    if (!nl) {
+      break;
+    }
+    csv_flush(c);
+    q = nl + 1;
+  }
+  return nsize;
+}
+
 int yql_download_h(const char *s, time_t period1, time_t period2, const char *interval, YArray *A)
 {
-  char   *data = NULL; size_t  size = 0;
-  int status = yql_download_r(s, period1, period2, interval, &data, &size);
-  if (status == YERROR_NERR) {
-    status = csv_history(s, data, size, A);
-    free(data);
+  const char *events = "history";
+
+  struct CsvStream c = { .symbol = s, .A = A, .status = YERROR_NERR };
+  int status = yql_download(s, period1, period2, interval, events, csv_write, &c);
+  if (c.len) {
+    csv_flush(&c);
   }
-  return status;
+  status = yql_download_e(status, c.head, strnlen(c.head, YTEXT_LENGTH));
+  return status != YERROR_NERR ? status : c.status;
+}
+
+/**
+ * Parses a history CSV body already in memory, header included, the way
+ * yql_download_h() parses a download.
+ */
+int yql_history_h(const char *s, const char *body, size_t n, YArray *A)
+{
+  struct CsvStream c = { .symbol = s, .A = A, .status = YERROR_NERR };
+  csv_write((char *) body, 1, n, &c);
+  if (c.len) {
+    csv_flush(&c);
+  }
+  return c.status;
 }
 
 int yql_download_f(const char *s, time_t period1, time_t period2, const char *interval, FILE *fstream)
 {
   const char *events = "history";
 
-/* #ifndef WIN32 */
-  curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, fwrite);
-  curl_easy_setopt(easy, CURLOPT_WRITEDATA, fstream);
-/* #endif */
-
-  int status = yql_download(s, period1, period2, interval, events);
+  int status = yql_download(s, period1, period2, interval, events, (curl_write_callback) fwrite, fstream);
   char line[YTEXT_LENGTH];
   rewind(fstream);
   if (fgets(line, YTEXT_LENGTH, fstream)) {
@@ -1221,97 +3740,402 @@ int yql_download_f(const char *s, time_t period1, time_t period2, const char *in
   return status;
 }
 
-static struct YHeadline *rss_item(xmlDoc *doc, xmlNode *node)
+#define YDOWNLOAD_ROWS 256 /*< rows parsed before they are handed over */
+
+/* A bulk download transfer: the file it is saved to and the rows parsed so far */
+struct YDownloadStream
 {
-  struct YHeadline *p = calloc(1, sizeof(struct YHeadline));
-  if (!p) {
-    log_error(logger, "%s:%d: calloc(): %s\n", __FILE__, __LINE__, strerror(errno));
-    return NULL;
+  FILE            *file;
+  YArray           A;
+  struct CsvStream csv;
+};
+
+static void download_rows(struct YRequest *r)
+{
+  const struct YDownload * const d = r->user;
+  struct YDownloadStream *x = r->stream;
+  YArray *A = &x->A;
+  for (size_t i = 0; d->row && i < A->length; i++) {
+    d->row(d->user, YArray_index(A, struct YHistory, i));
   }
+  A->length = 0;
+}
 
-#define xmlCharStrEqual(s1, s2) xmlStrEqual(s1, (const xmlChar *) s2)
+static size_t download_write(char *p, size_t size, size_t nmemb, void *user)
+{
+  struct YRequest *r = user;
+  const struct YDownload * const d = r->user;
+  struct YDownloadStream *x = r->stream;
+  size_t nsize = size * nmemb;
+  if (!x) {
+    x = r->stream = YArena_alloc(&r->arena, sizeof(struct YDownloadStream));
+    if (!x) {
+      return 0;
+    }
+    memset(x, 0, sizeof(struct YDownloadStream));
+    x->A.data = reallocarray(NULL, YDOWNLOAD_ROWS, sizeof(struct YHistory));
+    if (!x->A.data) {
+      log_error(logger, "%s:%d: reallocarray(%d): %s\n", __FILE__, __LINE__, YDOWNLOAD_ROWS, strerror(errno));
+      return 0;
+    }
+    x->A.capacity = YDOWNLOAD_ROWS;
+    x->csv.symbol = r->symbol, x->csv.A = &x->A, x->csv.status = YERROR_NERR;
+    if (d->open && !(x->file = d->open(d->user, r->symbol))) {
+      log_error(logger, "download_write(%s): cannot open file\n", r->symbol);
+      return 0;
+    }
+  }
+  if (x->file && fwrite(p, 1, nsize, x->file) != nsize) {
+    log_error(logger, "fwrite(%s): %s\n", r->symbol, strerror(errno));
+    return 0;
+  }
+  csv_write(p, size, nmemb, &x->csv);
+  download_rows(r);
+  return nsize;
+}
 
-  for (xmlNode *n = node->xmlChildrenNode; n; n = n->next) {
-    if (xmlCharStrEqual(n->name, "description")) {
-      p->description = xmlNodeListGetString(doc, n->xmlChildrenNode, 1);
-    } else if (xmlCharStrEqual(n->name, "guid")) {
-      p->guid = xmlNodeListGetString(doc, n->xmlChildrenNode, 1);
-    } else if (xmlCharStrEqual(n->name, "link")) {
-      p->link = xmlNodeListGetString(doc, n->xmlChildrenNode, 1);
-    } else if (xmlCharStrEqual(n->name, "pubDate")) {
-      p->pubDate = xmlNodeListGetString(doc, n->xmlChildrenNode, 1);
-    } else if (xmlCharStrEqual(n->name, "title")) {
-      p->title = xmlNodeListGetString(doc, n->xmlChildrenNode, 1);
+static void download_discard(struct YRequest *r)
+{
+  struct YDownloadStream *x = r->stream;
+  if (x) {
+    if (x->file) {
+      fclose(x->file);
     }
+    free(x->A.data);
+    r->stream = NULL; /* its memory stays with the arena */
   }
+}
 
-  return p;
+static int download_parse(struct YRequest *r)
+{
+  struct YDownloadStream *x = r->stream;
+  if (!x) {
+    return YERROR_CURL;
+  }
+  if (x->csv.len) {
+    csv_flush(&x->csv);
+    download_rows(r);
+  }
+  int status = yql_download_e(YERROR_NERR, x->csv.head, strnlen(x->csv.head, YTEXT_LENGTH));
+  if (x->file && fflush(x->file) != 0) {
+    log_error(logger, "fflush(%s): %s\n", r->symbol, strerror(errno));
+    status = status != YERROR_NERR ? status : YERROR_CERR;
+  }
+  return status != YERROR_NERR ? status : x->csv.status;
 }
 
-static int rss_read(xmlDoc *doc, xmlNode *node, const char *s)
+static const struct YFormat download_format = { download_write, download_parse, download_discard };
+
+/**
+ * Downloads the history of every symbol on a multi handle of its own,
+ * keeping at most d->parallel requests queued, so memory stays flat however
+ * long the list and foreground requests are not held up behind it.  The
+ * shared rate limiter, retries and circuit breaker apply as usual.  Safe to
+ * run off the UI thread: nothing touches the response caches.  Returns the
+ * first error status, if any.
+ */
+int yql_download_m(const char **symbols, size_t n, const struct YDownload *d)
 {
-  for (xmlNode *rss = node->xmlChildrenNode; rss; rss = rss->next) {
-    if (xmlCharStrEqual(rss->name, "channel")) {
-      struct YHeadline *p = NULL;
-      for (xmlNode *channel = rss->xmlChildrenNode; channel; channel = channel->next) {
-        if (xmlCharStrEqual(channel->name, "item")) {
-          struct YHeadline *q = rss_item(doc, channel);
-          if (!p) {
-            g_hash_table_insert(yql_headlines, strndup(s, YSTRING_LENGTH), q);
-          } else {
-            p->next = q;
-          }
-          p = q;
+  struct YMulti m = { NULL, NULL };
+  if (yql_multi_open(&m) != YERROR_NERR) {
+    return YERROR_CURL;
+  }
+
+  const char *events = "history";
+  size_t parallel = d->parallel ? d->parallel : YDOWNLOAD_PARALLEL;
+  int status = YERROR_NERR;
+  for (size_t i = 0; i < n || m.requests->len > 0; ) {
+    for ( ; i < n && m.requests->len < parallel; i++) {
+      char *url = YDOWNLOAD_URL(symbols[i], d->period1, d->period2, d->interval, events);
+      int rstatus = url ? yql_request(&m, url, NULL, symbols[i], &download_format, d) : YERROR_CERR;
+      free(url);
+      if (rstatus != YERROR_NERR) {
+        status = status == YERROR_NERR ? rstatus : status;
+        if (d->done) {
+          d->done(rstatus, symbols[i]);
         }
       }
     }
+    if (m.requests->len > 0 && yql_multi_step(&m, d->done, &status) != CURLM_OK) {
+      status = YERROR_CURL;
+      break;
+    }
   }
-  return YERROR_NERR;
+
+  status = yql_multi_read(&m, d->done, status);
+  yql_multi_close(&m);
+  yql_flight_prune();
+  return status;
 }
 
-static int rss_parse(struct JsonBuffer *buffer, const char *s)
+/**
+ * Feeds are read with SAX callbacks as they stream in, without building a
+ * document.  Items come newest first, so reading stops at the first one
+ * already cached, and only the items before it are prepended to the list.
+ * When nothing changed, that is one item parsed per poll.
+ */
+#define RSS_HEADLINES 100 /*< kept per symbol */
+
+#define xmlCharStrEqual(s1, s2) xmlStrEqual(s1, (const xmlChar *) s2)
+
+static const struct
 {
-  xmlDoc *doc = xmlReadMemory(buffer->data, buffer->size, "noname.xml", NULL, 0);
-  if (!doc) {
-    log_warn(logger, "xmlReadMemory()\n");
-    return YERROR_XML;
+  const char *name;
+  size_t      offset;
+} rss_fields[] = {
+  { "description", offsetof(struct YHeadline, description) },
+  { "guid",        offsetof(struct YHeadline, guid)        },
+  { "link",        offsetof(struct YHeadline, link)        },
+  { "pubDate",     offsetof(struct YHeadline, pubDate)     },
+  { "title",       offsetof(struct YHeadline, title)       },
+};
+
+struct RssStream
+{
+  xmlParserCtxtPtr ctxt;
+  const struct YHeadline *known; /*< cached list when the transfer began */
+  struct YHeadline *head;        /*< new items, in feed order */
+  struct YHeadline *tail;
+  struct YHeadline *item;        /*< being read */
+  xmlChar **text;                /*< member of item being read, if any */
+  int   depth;                   /*< rss 1, channel 2, item 3 */
+  bool  rss;                     /*< the root element is <rss> */
+  bool  done;                    /*< reached a cached item */
+};
+
+static bool rss_known(const struct YHeadline *p, const xmlChar *guid)
+{
+  for ( ; p; p = p->next) {
+    if (p->guid && xmlStrEqual(p->guid, guid)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void rss_start(void *ctx, const xmlChar *name, const xmlChar *prefix _U_, const xmlChar *URI _U_,
+                      int nb_namespaces _U_, const xmlChar **namespaces _U_,
+                      int nb_attributes _U_, int nb_defaulted _U_, const xmlChar **attributes _U_)
+{
+  struct RssStream *x = ctx;
+  switch (++x->depth) {
+  case 1:
+    x->rss = xmlCharStrEqual(name, "rss");
+    break;
+  case 3:
+    if (x->rss && xmlCharStrEqual(name, "item")) {
+      x->item = calloc(1, sizeof(struct YHeadline));
+      if (!x->item) {
+        log_error(logger, "%s:%d: calloc(): %s\n", __FILE__, __LINE__, strerror(errno));
+      }
+    }
+    break;
+  case 4:
+    for (size_t i = 0; x->item && i < sizeof(rss_fields) / sizeof(rss_fields[0]); i++) {
+      if (xmlCharStrEqual(name, rss_fields[i].name)) {
+        x->text = (xmlChar **) ((char *) x->item + rss_fields[i].offset);
+        xmlFree(*x->text);
+        *x->text = NULL;
+        break;
+      }
+    }
+    break;
+  }
+}
+
+static void rss_end(void *ctx, const xmlChar *name _U_, const xmlChar *prefix _U_, const xmlChar *URI _U_)
+{
+  struct RssStream *x = ctx;
+  if (x->depth == 4 && x->text) {
+    if (x->text == &x->item->guid && x->item->guid && rss_known(x->known, x->item->guid)) {
+      YHeadline_free(x->item);
+      x->item = NULL, x->done = true;
+      xmlStopParser(x->ctxt);
+    }
+    x->text = NULL;
+  } else if (x->depth == 3 && x->item) {
+    if (x->tail) {
+      x->tail->next = x->item;
+    } else {
+      x->head = x->item;
+    }
+    x->tail = x->item, x->item = NULL;
+  }
+  x->depth--;
+}
+
+static void rss_characters(void *ctx, const xmlChar *ch, int len)
+{
+  struct RssStream *x = ctx;
+  if (x->text) {
+    *x->text = xmlStrncat(*x->text, ch, len);
+  }
+}
+
+static xmlSAXHandler rss_sax = {
+  .initialized    = XML_SAX2_MAGIC,
+  .startElementNs = rss_start,
+  .endElementNs   = rss_end,
+  .characters     = rss_characters,
+  .cdataBlock     = rss_characters,
+};
+
+/* Prepends the new items to the cached list, which is trimmed to RSS_HEADLINES */
+static void rss_merge(struct RssStream *x, const char *s)
+{
+  if (!x->head) {
+    return;
+  }
+
+  gpointer key = NULL, value = NULL;
+  if (g_hash_table_steal_extended(yql_headlines, s, &key, &value)) {
+    x->tail->next = value;
+  } else {
+    key = strndup(s, YSTRING_LENGTH);
+  }
+  struct YHeadline *p = x->head;
+  for (size_t i = 1; p->next && i < RSS_HEADLINES; i++) {
+    p = p->next;
+  }
+  YHeadline_destroy(p->next);
+  p->next = NULL;
+
+  g_hash_table_insert(yql_headlines, key, x->head);
+  x->head = x->tail = NULL;
+}
+
+static size_t rss_write(char *p, size_t size, size_t nmemb, void *user)
+{
+  struct YRequest *r = user;
+  struct RssStream *x = r->stream;
+  size_t nsize = size * nmemb;
+  if (!x) {
+    x = YArena_alloc(&r->arena, sizeof(struct RssStream));
+    if (!x) {
+      return 0;
+    }
+    memset(x, 0, sizeof(struct RssStream));
+    x->known = g_hash_table_lookup(yql_headlines, r->symbol);
+    x->ctxt = xmlCreatePushParserCtxt(&rss_sax, x, NULL, 0, r->url);
+    if (!x->ctxt) {
+      log_error(logger, "xmlCreatePushParserCtxt(%s)\n", r->url);
+      return 0;
+    }
+    r->stream = x;
+  }
+  if (!x->done) {
+    xmlParseChunk(x->ctxt, p, nsize, 0);
+  }
+  return nsize;
+}
+
+static void rss_discard(struct YRequest *r)
+{
+  struct RssStream *x = r->stream;
+  if (x) {
+    YHeadline_destroy(x->head);
+    YHeadline_free(x->item);
+    xmlFreeParserCtxt(x->ctxt);
+    r->stream = NULL; /* its memory stays with the arena */
   }
-  xmlNode *root = xmlDocGetRootElement(doc);
-  if (!root) {
-    log_warn(logger, "xmlDocGetRootElement()\n");
+}
+
+static int rss_parse(struct YRequest *r)
+{
+  struct RssStream *x = r->stream;
+  if (!x) {
+    log_warn(logger, "rss_parse(%s): empty response\n", r->url);
     return YERROR_XML;
   }
-  if (!xmlCharStrEqual(root->name, "rss")) {
-    log_warn(logger, "xmlDocGetRootElement(): %s\n", root->name);
-    return YERROR_YHOO;
+  if (!x->done) {
+    xmlParseChunk(x->ctxt, NULL, 0, 1);
   }
 
-  int status = rss_read(doc, root, s);
-  xmlFreeDoc(doc);
+  int status = YERROR_NERR;
+  if (!x->done && !x->ctxt->wellFormed) {
+    log_warn(logger, "xmlParseChunk(%s): not well-formed\n", r->url);
+    status = YERROR_XML;
+  } else if (!x->rss) {
+    log_warn(logger, "rss_parse(%s): not an RSS feed\n", r->url);
+    status = YERROR_YHOO;
+  } else {
+    rss_merge(x, r->symbol);
+  }
+  rss_discard(r);
   return status;
 }
 
+static const struct YFormat rss_format = { rss_write, rss_parse, rss_discard };
+
 int yql_headline(const char *s)
 {
-  char *url = yql_asprintf(Y_HEADLINE "?s=%s", s);
-  if (!url) {
-    log_error(logger, "yql_asprintf(%s)\n", Y_HEADLINE);
-    return YERROR_CERR;
+  struct YArena a = { .head = NULL };
+  char *url = YArena_sprintf(&a, Y_HEADLINE "?s=%s", s);
+  int status = YERROR_CERR;
+  if (url) {
+    status = yql_perform(url, NULL, s, &rss_format);
+  } else {
+    log_error(logger, "YArena_sprintf(%s)\n", Y_HEADLINE);
   }
+  YArena_reset(&a);
+  return status;
+}
 
-  curl_easy_setopt(easy, CURLOPT_URL, url);
-  curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, callback);
-  struct JsonBuffer buffer = { .data = NULL, .size = 0 };
-  curl_easy_setopt(easy, CURLOPT_WRITEDATA, &buffer);
-  CURLcode code = curl_easy_perform(easy);
-  if (code != CURLE_OK) {
-    log_warn(logger, "curl_easy_perform(%s): %s\n", url, curl_easy_strerror(code));
-    free(url);
-    return YERROR_CURL;
+/**
+ * Fetches every YFUNDAMENTAL_TYPES series at both frequencies, all in one
+ * request per symbol (the endpoint takes a single symbol), transferred
+ * concurrently.  A symbol already held is fetched only from the day after
+ * its as-of date; others YFUNDAMENTAL_YEARS back.  Requests are keyed by
+ * symbol alone, as the period runs up to now, so YTTL_TIMESERIES and
+ * coalescing apply across calls.
+ */
+int yql_timeseries(const char **symbols, size_t n)
+{
+  int status = yql_multi_begin();
+  if (status != YERROR_NERR) {
+    return status;
   }
-  free(url);
 
-  int status = rss_parse(&buffer, s);
-  free(buffer.data);
-  return status;
+  GString *types = g_string_sized_new(YURL_LENGTH);
+  for (int f = 0; f < YFREQUENCIES; f++) {
+    for (int t = 0; t < YFUNDAMENTALS; t++) {
+      g_string_append_printf(types, "%s%s%s", types->len ? "," : "", yfrequency_prefixes[f], yql_fundamental_name(t));
+    }
+  }
+
+  GHashTable *seen = g_hash_table_new(g_str_hash, g_str_equal);
+  time_t now = time(NULL);
+  for (size_t i = 0; i < n; i++) {
+    const char *s = symbols[i];
+    if (!strnlen(s, YSTRING_LENGTH) || !g_hash_table_add(seen, (char *) s)) {
+      continue;
+    }
+    time_t period1 = now - YFUNDAMENTAL_YEARS * 366 * 86400L;
+    long r = yql_fundamentals_row(s);
+    struct tm tm = { 0 };
+    if (r >= 0 && sscanf(yql_fundamentals.asOfDates[r], "%d-%d-%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday) == 3) {
+      tm.tm_year -= 1900, tm.tm_mon -= 1;
+      period1 = timegm(&tm) + 86400L;
+    }
+    struct YArena a = { .head = NULL };
+    char *alias = YArena_sprintf(&a, Y_TIMESERIES "/%s?symbol=%s", s, s);
+    char *url = YArena_sprintf(&a, Y_TIMESERIES "/%s?symbol=%s" "&type=%s" "&period1=%ld" "&period2=%ld",
+                               s, s, types->str, (long) period1, (long) now);
+    int qstatus = YERROR_CERR;
+    if (alias && url) {
+      log_debug(logger, "yql_query(%s)\n", url);
+      qstatus = yql_perform(url, alias, s, &json_format);
+    } else {
+      log_error(logger, "YArena_sprintf(%s)\n", Y_TIMESERIES);
+    }
+    if (status == YERROR_NERR) {
+      status = qstatus; /* a failed symbol does not hold back the rest */
+    }
+    YArena_reset(&a);
+  }
+  g_hash_table_destroy(seen);
+  g_string_free(types, TRUE);
+
+  int rstatus = yql_multi_end(NULL);
+  return status != YERROR_NERR ? status : rstatus;
 }
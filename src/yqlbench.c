@@ -0,0 +1,268 @@
+/**
+ * yqlbench: load generator driving the yql layer, normally against yqld.
+ *
+ *   cc -O2 -pthread -o yqlbench src/yqlbench.c src/yql.c src/jstream.c src/http.c src/log.c \
+ *      $(pkg-config --cflags --libs glib-2.0 json-glib-1.0 libxml-2.0 libcurl)
+ *   GAMMATERM_ORIGIN=http://127.0.0.1:8080 ./yqlbench [-n symbols] [-c concurrency] [-r rounds] [-m mode]
+ *
+ * mode := quote | batch | chart | spark | options | csv
+ *
+ * Each round requests every one of the n synthetic symbols, keeping up to c
+ * calls queued on the multi handle at once (batch and spark make a single
+ * call, packing many symbols per request instead).  Freshness stamps are dropped between
+ * rounds so every round hits the server.  Reports throughput per round and
+ * the peak resident set size.
+ *
+ * csv makes no requests: it parses a generated history body of n rows with
+ * the sscanf() row format yql used before and with yql_history_h(), and
+ * counts the rows on which the two disagree as errors of the latter.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../include/http.h"
+#include "../include/yql.h"
+
+#define CSV_LINE_LENGTH 255 /*< as yql buffers a history row */
+
+static size_t failures = 0;
+
+static int done(int status, const char *symbol)
+{
+  if (status != YERROR_NERR) {
+    failures++;
+    if (failures <= 10) {
+      fprintf(stderr, "yqlbench: %s: error %d\n", symbol, status);
+    }
+  }
+  return status;
+}
+
+static double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Daily history rows of a random walk, some with more digits than a double holds */
+static char *csv_body(size_t n, size_t *length)
+{
+  size_t capacity = 64 + n * 128;
+  char *body = malloc(capacity);
+  if (!body) {
+    return NULL;
+  }
+  size_t len = snprintf(body, capacity, "Date,Open,High,Low,Close,Adj Close,Volume\n");
+  double close = 100.0;
+  srand(1);
+  for (size_t i = 0; i < n; i++) {
+    time_t t = 86400 * (time_t) i;
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    double open = close * (1 + (rand() % 2001 - 1000) / 1e5);
+    close = open * (1 + (rand() % 2001 - 1000) / 1e5);
+    double high = (open > close ? open : close) * 1.005, low = (open < close ? open : close) * 0.995;
+    len += snprintf(body + len, capacity - len, i % 16 ? "%04d-%02d-%02d,%.6f,%.6f,%.6f,%.6f,%.6f,%d\n"
+                                                       : "%04d-%02d-%02d,%.6f,%.6f,%.6f,%.6f,%.17g,%d\n",
+                    tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, open, high, low, close, close * 0.98, rand());
+  }
+  *length = len;
+  return body;
+}
+
+/* csv_history() as it was, scanning each row, copied out of the body, with sscanf() */
+static int sscanf_history(const char *body, YArray *A)
+{
+  const char *format = YDATE_IFORMAT ",%lf,%lf,%lf,%lf,%lf,%ld";
+  char line[CSV_LINE_LENGTH + 1];
+  for (const char *p = strchr(body, '\n'); p && p[1]; p = strchr(p, '\n')) {
+    size_t k = strcspn(++p, "\n");
+    if (k > CSV_LINE_LENGTH) {
+      return YERROR_JSON;
+    }
+    memcpy(line, p, k);
+    line[k] = 0;
+
+    if (A->length >= A->capacity) {
+      size_t capacity = A->capacity * 2;
+      char *data = reallocarray(A->data, capacity, sizeof(struct YHistory));
+      if (!data) {
+        return YERROR_CERR;
+      }
+      A->data = data, A->capacity = capacity;
+    }
+    struct YHistory *h = YArray_index(A, struct YHistory, A->length);
+    if (sscanf(line, format, h->date, &h->open, &h->high, &h->low, &h->close, &h->adjclose, &h->volume) < 7) {
+      return YERROR_JSON;
+    }
+    A->length++;
+  }
+  return YERROR_NERR;
+}
+
+static size_t csv_mismatches(const YArray *A, const YArray *B)
+{
+  size_t n = A->length > B->length ? A->length - B->length : B->length - A->length;
+  for (size_t i = 0; i < A->length && i < B->length; i++) {
+    const struct YHistory *a = YArray_index(A, struct YHistory, i), *b = YArray_index(B, struct YHistory, i);
+    n += strcmp(a->date, b->date) || a->volume != b->volume ||
+      memcmp(&a->open, &b->open, sizeof(double)) || memcmp(&a->high, &b->high, sizeof(double)) ||
+      memcmp(&a->low, &b->low, sizeof(double)) || memcmp(&a->close, &b->close, sizeof(double)) ||
+      memcmp(&a->adjclose, &b->adjclose, sizeof(double));
+  }
+  return n;
+}
+
+static int bench_csv(size_t n, size_t rounds)
+{
+  size_t length = 0;
+  char *body = csv_body(n, &length);
+  if (!body) {
+    perror("malloc");
+    return EXIT_FAILURE;
+  }
+
+  printf("%-8s %8s %8s %10s %10s %8s\n", "parser", "round", "rows", "seconds", "rows/s", "errors");
+  for (size_t k = 0; k < rounds; k++) {
+    YArray A = { .data = NULL, .length = 0, .capacity = YARRAY_LENGTH };
+    YArray B = { .data = NULL, .length = 0, .capacity = YARRAY_LENGTH };
+    A.data = reallocarray(A.data, A.capacity, sizeof(struct YHistory));
+    B.data = reallocarray(B.data, B.capacity, sizeof(struct YHistory));
+    if (!A.data || !B.data) {
+      perror("reallocarray");
+      free(A.data);
+      free(B.data);
+      free(body);
+      return EXIT_FAILURE;
+    }
+
+    double t = now();
+    int status = sscanf_history(body, &A);
+    t = now() - t;
+    printf("%-8s %8zu %8zu %10.3f %10.0f %8d\n", "sscanf", k, A.length, t, A.length / t, status != YERROR_NERR);
+
+    t = now();
+    status = yql_history_h("S00000", body, length, &B);
+    t = now() - t;
+    failures = status != YERROR_NERR ? n : csv_mismatches(&A, &B);
+    printf("%-8s %8zu %8zu %10.3f %10.0f %8zu\n", "csv", k, B.length, t, B.length / t, failures);
+
+    free(A.data);
+    free(B.data);
+  }
+  free(body);
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static size_t round_each(int (*f)(const char *), const char **symbols, size_t n, size_t c)
+{
+  size_t calls = 0;
+  for (size_t i = 0; i < n; i += c) {
+    yql_multi_begin();
+    for (size_t j = i; j < n && j < i + c; j++, calls++) {
+      done(f(symbols[j]), symbols[j]);
+    }
+    yql_multi_end(done);
+  }
+  return calls;
+}
+
+int main(int argc, char *argv[])
+{
+  size_t n = 10000, c = 64, rounds = 3;
+  const char *mode = "batch";
+  int opt = 0;
+  while ((opt = getopt(argc, argv, "n:c:r:m:")) != -1) {
+    switch (opt) {
+    case 'n':
+      n = strtoul(optarg, NULL, 10);
+      break;
+    case 'c':
+      c = strtoul(optarg, NULL, 10);
+      break;
+    case 'r':
+      rounds = strtoul(optarg, NULL, 10);
+      break;
+    case 'm':
+      mode = optarg;
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-n symbols] [-c concurrency] [-r rounds] [-m quote|batch|chart|spark|options|csv]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (!n || !c) {
+    return EXIT_FAILURE;
+  }
+  if (strcmp(mode, "csv") == 0) {
+    if (yql_init() != YERROR_NERR) {
+      fprintf(stderr, "yqlbench: initialization failed\n");
+      return EXIT_FAILURE;
+    }
+    int status = bench_csv(n, rounds);
+    yql_free();
+    return status;
+  }
+  if (!getenv(HTTP_ORIGIN_ENV) && !getenv(HTTP_REPLAY_ENV)) {
+    fprintf(stderr, "yqlbench: neither %s nor %s set, refusing to load the live service\n", HTTP_ORIGIN_ENV, HTTP_REPLAY_ENV);
+    return EXIT_FAILURE;
+  }
+
+  char (*names)[YSTRING_LENGTH + 1] = calloc(n, YSTRING_LENGTH + 1);
+  const char **symbols = calloc(n, sizeof(char *));
+  if (!names || !symbols) {
+    perror("calloc");
+    return EXIT_FAILURE;
+  }
+  for (size_t i = 0; i < n; i++) {
+    snprintf(names[i], YSTRING_LENGTH + 1, "S%05zu", i);
+    symbols[i] = names[i];
+  }
+
+  if (http_init() != HTTP_OK || yql_init() != YERROR_NERR || yql_open() != YERROR_NERR) {
+    fprintf(stderr, "yqlbench: initialization failed\n");
+    return EXIT_FAILURE;
+  }
+
+  printf("%-8s %8s %8s %10s %10s %12s %8s\n", "mode", "round", "calls", "seconds", "symbols/s", "maxrss(KiB)", "errors");
+  for (size_t k = 0; k < rounds; k++) {
+    size_t calls = 0;
+    failures = 0;
+    yql_invalidate();
+
+    double t = now();
+    if (strcmp(mode, "quote") == 0) {
+      calls = round_each(yql_quote, symbols, n, c);
+    } else if (strcmp(mode, "chart") == 0) {
+      calls = round_each(yql_chart, symbols, n, c);
+    } else if (strcmp(mode, "options") == 0) {
+      calls = round_each(yql_options, symbols, n, c);
+    } else if (strcmp(mode, "batch") == 0) {
+      done(yql_quote_batch(symbols, n, NULL), symbols[0]);
+      calls = 1;
+    } else if (strcmp(mode, "spark") == 0) {
+      done(yql_spark(symbols, n), symbols[0]);
+      calls = 1;
+    } else {
+      fprintf(stderr, "yqlbench: unknown mode %s\n", mode);
+      return EXIT_FAILURE;
+    }
+    t = now() - t;
+
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    printf("%-8s %8zu %8zu %10.3f %10.0f %12ld %8zu\n", mode, k, calls, t, n / t, ru.ru_maxrss, failures);
+  }
+
+  yql_close();
+  yql_free();
+  http_free();
+  free(symbols);
+  free(names);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,731 @@
+/**
+ * yqld: local stand-in for the Yahoo Finance and BLS endpoints used by
+ * gammaterm, serving synthetic but schema-valid data for any symbol.
+ *
+ *   cc -O2 -pthread -o yqld src/yqld.c
+ *   ./yqld [-p port] [-n bars] [-k strikes] [-d delay_ms]
+ *
+ * Point gammaterm (or yqlbench) at it with GAMMATERM_ORIGIN=http://127.0.0.1:port;
+ * the http transport then keeps only the path and query of every URL, which
+ * is how requests are routed here:
+ *
+ *   /v7/finance/quote?symbols=A,B           /v7/finance/spark?symbols=A,B
+ *   /v8/finance/chart/A                     /v10/finance/quoteSummary/A
+ *   /v7/finance/options/A                   /v7/finance/download/A
+ *   /rss/2.0/headline?s=A                   /pub/time.series/...
+ *   /ws/fundamentals-timeseries/v1/finance/timeseries/A
+ *   /publicAPI/v1/timeseries/data/          (POST, JSON body)
+ *
+ * Data is a deterministic function of the symbol, so repeated runs are
+ * comparable.  One thread serves each keep-alive connection.
+ */
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define YQLD_PORT        8080
+#define YQLD_BARS        64
+#define YQLD_STRIKES     32
+#define YQLD_HEADLINES   20
+#define YQLD_REQUEST     16384
+#define YQLD_SYMBOL      31
+#define YQLD_DAY         86400
+
+static int bars = YQLD_BARS;
+static int strikes = YQLD_STRIKES;
+static int delay = 0; /*< milliseconds */
+
+typedef struct Buffer
+{
+  char   *data;
+  size_t  size;
+  size_t  capacity;
+} Buffer;
+
+static void bprintf(Buffer *b, const char *fmt, ...)
+{
+  for (;;) {
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(b->data + b->size, b->capacity - b->size, fmt, ap);
+    va_end(ap);
+    if (n >= 0 && (size_t) n < b->capacity - b->size) {
+      b->size += n;
+      return;
+    }
+    b->capacity = b->capacity ? b->capacity * 2 : 4096;
+    while (n >= 0 && b->capacity - b->size <= (size_t) n) {
+      b->capacity *= 2;
+    }
+    if (!(b->data = realloc(b->data, b->capacity))) {
+      perror("realloc");
+      exit(EXIT_FAILURE);
+    }
+  }
+}
+
+/* Deterministic per-symbol random walk */
+
+static uint64_t seed(const char *s)
+{
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (; *s; s++) {
+    h = (h ^ (unsigned char) *s) * 0x100000001b3ULL;
+  }
+  return h ? h : 1;
+}
+
+static double uniform(uint64_t *x)
+{
+  *x ^= *x << 13, *x ^= *x >> 7, *x ^= *x << 17;
+  return (*x >> 11) * 0x1.0p-53;
+}
+
+struct Bar
+{
+  int64_t timestamp;
+  double  open, high, low, close;
+  int64_t volume;
+};
+
+/* Daily bars ending today, n of them, the last one still open */
+static struct Bar *walk(const char *s, int n, double *previous)
+{
+  struct Bar *b = calloc(n > 0 ? n : 1, sizeof(struct Bar));
+  uint64_t x = seed(s);
+  double p = 10 + 500 * uniform(&x);
+  int64_t today = time(NULL) / YQLD_DAY * YQLD_DAY + 14 * 3600 + 30 * 60;
+  *previous = p;
+  for (int i = 0; i < n; i++) {
+    double o = p, c = o * (1 + 0.04 * (uniform(&x) - 0.5));
+    b[i].timestamp = today - (int64_t) (n - 1 - i) * YQLD_DAY;
+    b[i].open = o, b[i].close = c;
+    b[i].high = (o > c ? o : c) * (1 + 0.01 * uniform(&x));
+    b[i].low = (o < c ? o : c) * (1 - 0.01 * uniform(&x));
+    b[i].volume = 100000 + (int64_t) (5000000 * uniform(&x));
+    *previous = p, p = c;
+  }
+  return b;
+}
+
+static double price(const char *s)
+{
+  double previous = 0;
+  struct Bar *b = walk(s, 2, &previous);
+  double p = b[1].close;
+  free(b);
+  return p;
+}
+
+/* Request parsing */
+
+static void urldecode(char *s)
+{
+  char *d = s;
+  for (; *s; s++) {
+    if (*s == '%' && s[1] && s[2]) {
+      char hex[3] = { s[1], s[2], 0 };
+      *d++ = (char) strtol(hex, NULL, 16), s += 2;
+    } else {
+      *d++ = *s == '+' ? ' ' : *s;
+    }
+  }
+  *d = 0;
+}
+
+/* Returns the value of header name in the head of request, or NULL if absent */
+static const char *header(const char *request, const char *name)
+{
+  size_t len = strlen(name);
+  for (const char *p = strstr(request, "\r\n"); p && strncmp(p, "\r\n\r\n", 4) != 0; p = strstr(p + 2, "\r\n")) {
+    if (strncasecmp(p + 2, name, len) == 0 && p[2 + len] == ':') {
+      return p + 3 + len + strspn(p + 3 + len, " \t");
+    }
+  }
+  return NULL;
+}
+
+/* Copies the value of query parameter k into v, returning false if absent */
+static bool param(const char *query, const char *k, char *v, size_t n)
+{
+  size_t len = strlen(k);
+  for (const char *p = query; p && *p; p = strchr(p, '&'), p = p ? p + 1 : NULL) {
+    if (strncmp(p, k, len) == 0 && p[len] == '=') {
+      p += len + 1;
+      size_t m = strcspn(p, "&");
+      if (m >= n) {
+        m = n - 1;
+      }
+      memcpy(v, p, m);
+      v[m] = 0;
+      urldecode(v);
+      return true;
+    }
+  }
+  return false;
+}
+
+static int range_bars(const char *query)
+{
+  static const struct { const char *range; int bars; } ranges[] = {
+    { "1d", 1 }, { "5d", 5 }, { "1mo", 21 }, { "3mo", 63 }, { "6mo", 126 },
+    { "1y", 252 }, { "2y", 504 }, { "5y", 1260 }, { "10y", 2520 }, { "max", 5000 },
+  };
+  char v[32];
+  if (param(query, "period1", v, sizeof(v))) {
+    int64_t p1 = atoll(v), p2 = time(NULL);
+    if (param(query, "period2", v, sizeof(v))) {
+      p2 = atoll(v);
+    }
+    int n = (int) ((p2 - p1) / YQLD_DAY) + 1;
+    return n < 1 ? 1 : n;
+  }
+  if (param(query, "range", v, sizeof(v))) {
+    for (size_t i = 0; i < sizeof(ranges) / sizeof(ranges[0]); i++) {
+      if (strcmp(v, ranges[i].range) == 0) {
+        return ranges[i].bars;
+      }
+    }
+  }
+  return bars;
+}
+
+/* Endpoints */
+
+static void json_error(Buffer *b, const char *response)
+{
+  bprintf(b, "{\"%s\":{\"result\":null,\"error\":{\"code\":\"Not Found\",\"description\":\"No data found\"}}}", response);
+}
+
+static void quote(Buffer *b, const char *s)
+{
+  double previous = 0;
+  struct Bar *r = walk(s, 252, &previous);
+  const struct Bar *t = &r[251];
+  double lo = t->low, hi = t->high;
+  for (int i = 0; i < 252; i++) {
+    lo = r[i].low < lo ? r[i].low : lo, hi = r[i].high > hi ? r[i].high : hi;
+  }
+  bprintf(b, "{\"symbol\":\"%s\",\"shortName\":\"%s Synthetic\",\"longName\":\"%s Synthetic Inc.\","
+          "\"quoteType\":\"EQUITY\",\"marketState\":\"REGULAR\",\"currency\":\"USD\",\"exchange\":\"NMS\","
+          "\"fullExchangeName\":\"NasdaqGS\",\"exchangeTimezoneName\":\"America/New_York\","
+          "\"exchangeTimezoneShortName\":\"EDT\",\"gmtOffSetMilliseconds\":-14400000,\"priceHint\":2,"
+          "\"regularMarketPrice\":%.4f,\"regularMarketChange\":%.4f,\"regularMarketChangePercent\":%.4f,"
+          "\"regularMarketOpen\":%.4f,\"regularMarketDayHigh\":%.4f,\"regularMarketDayLow\":%.4f,"
+          "\"regularMarketPreviousClose\":%.4f,\"regularMarketVolume\":%ld,\"regularMarketTime\":%ld,"
+          "\"regularMarketDayRange\":\"%.2f - %.2f\",\"bid\":%.4f,\"ask\":%.4f,\"bidSize\":10,\"askSize\":12,"
+          "\"fiftyTwoWeekLow\":%.4f,\"fiftyTwoWeekHigh\":%.4f,\"fiftyTwoWeekLowChange\":%.4f,"
+          "\"fiftyTwoWeekHighChange\":%.4f,\"fiftyTwoWeekRange\":\"%.2f - %.2f\","
+          "\"marketCap\":%ld,\"sharesOutstanding\":%ld,\"trailingPE\":%.2f,\"forwardPE\":%.2f,"
+          "\"epsTrailingTwelveMonths\":%.4f,\"tradeable\":false,\"triggerable\":true}",
+          s, s, s, t->close, t->close - t->open, (t->close / t->open - 1) * 100,
+          t->open, t->high, t->low, t->open, t->volume, t->timestamp, t->low, t->high,
+          t->close * 0.999, t->close * 1.001, lo, hi, t->close - lo, t->close - hi, lo, hi,
+          (int64_t) (t->close * 1e9), (int64_t) 1e9, 20 + 10 * (t->close / hi), 18.0, t->close / 20);
+  free(r);
+}
+
+static void quotes(Buffer *b, const char *query)
+{
+  char *symbols = malloc(YQLD_REQUEST);
+  if (!param(query, "symbols", symbols, YQLD_REQUEST)) {
+    json_error(b, "quoteResponse");
+    free(symbols);
+    return;
+  }
+  bprintf(b, "{\"quoteResponse\":{\"result\":[");
+  int i = 0;
+  for (char *s = strtok(symbols, ","); s; s = strtok(NULL, ","), i++) {
+    bprintf(b, i ? "," : "");
+    quote(b, s);
+  }
+  bprintf(b, "],\"error\":null}}");
+  free(symbols);
+}
+
+static void series(Buffer *b, const struct Bar *r, int n, const char *key)
+{
+  bprintf(b, "\"%s\":[", key);
+  for (int i = 0; i < n; i++) {
+    if (strcmp(key, "volume") == 0) {
+      bprintf(b, i ? ",%ld" : "%ld", r[i].volume);
+    } else {
+      double v = strcmp(key, "open") == 0 ? r[i].open : strcmp(key, "high") == 0 ? r[i].high :
+                 strcmp(key, "low")  == 0 ? r[i].low  : r[i].close;
+      bprintf(b, i ? ",%.4f" : "%.4f", v);
+    }
+  }
+  bprintf(b, "]");
+}
+
+static void timestamps(Buffer *b, const struct Bar *r, int n)
+{
+  bprintf(b, "\"timestamp\":[");
+  for (int i = 0; i < n; i++) {
+    bprintf(b, i ? ",%ld" : "%ld", r[i].timestamp);
+  }
+  bprintf(b, "]");
+}
+
+static void meta(Buffer *b, const char *s, const struct Bar *r, int n, double previous)
+{
+  bprintf(b, "\"meta\":{\"currency\":\"USD\",\"symbol\":\"%s\",\"exchangeName\":\"NMS\",\"instrumentType\":\"EQUITY\","
+          "\"regularMarketPrice\":%.4f,\"chartPreviousClose\":%.4f,\"dataGranularity\":\"1d\"}",
+          s, r[n - 1].close, previous);
+}
+
+static void chart(Buffer *b, const char *s, const char *query)
+{
+  double previous = 0;
+  int n = range_bars(query);
+  struct Bar *r = walk(s, n, &previous);
+  bprintf(b, "{\"chart\":{\"result\":[{");
+  meta(b, s, r, n, previous);
+  bprintf(b, ",");
+  timestamps(b, r, n);
+  bprintf(b, ",\"indicators\":{\"quote\":[{");
+  series(b, r, n, "close"), bprintf(b, ",");
+  series(b, r, n, "high"),  bprintf(b, ",");
+  series(b, r, n, "low"),   bprintf(b, ",");
+  series(b, r, n, "open"),  bprintf(b, ",");
+  series(b, r, n, "volume");
+  bprintf(b, "}],\"adjclose\":[{");
+  series(b, r, n, "adjclose");
+  bprintf(b, "}]}}],\"error\":null}}");
+  free(r);
+}
+
+static void spark(Buffer *b, const char *query)
+{
+  char *symbols = malloc(YQLD_REQUEST);
+  if (!param(query, "symbols", symbols, YQLD_REQUEST)) {
+    json_error(b, "spark");
+    free(symbols);
+    return;
+  }
+  int n = range_bars(query);
+  bprintf(b, "{\"spark\":{\"result\":[");
+  int i = 0;
+  for (char *s = strtok(symbols, ","); s; s = strtok(NULL, ","), i++) {
+    double previous = 0;
+    struct Bar *r = walk(s, n, &previous);
+    bprintf(b, "%s{\"symbol\":\"%s\",\"response\":[{", i ? "," : "", s);
+    meta(b, s, r, n, previous);
+    bprintf(b, ",");
+    timestamps(b, r, n);
+    bprintf(b, ",\"indicators\":{\"quote\":[{");
+    series(b, r, n, "close");
+    bprintf(b, "}],\"adjclose\":[{");
+    series(b, r, n, "adjclose");
+    bprintf(b, "}]}}]}");
+    free(r);
+  }
+  bprintf(b, "],\"error\":null}}");
+  free(symbols);
+}
+
+static void quoteSummary(Buffer *b, const char *s, const char *query)
+{
+  char modules[1024] = "";
+  param(query, "modules", modules, sizeof(modules));
+  bprintf(b, "{\"quoteSummary\":{\"result\":[{");
+  int i = 0;
+  for (char *m = strtok(modules, ","); m; m = strtok(NULL, ","), i++) {
+    bprintf(b, i ? "," : "");
+    if (strcmp(m, "assetProfile") == 0) {
+      bprintf(b, "\"assetProfile\":{\"city\":\"Springfield\",\"country\":\"United States\","
+              "\"industry\":\"Synthetic Data\",\"sector\":\"Technology\",\"fullTimeEmployees\":%d,"
+              "\"longBusinessSummary\":\"%s is a synthetic company served by yqld.\"}", 1000, s);
+    } else if (strcmp(m, "defaultKeyStatistics") == 0) {
+      bprintf(b, "\"defaultKeyStatistics\":{\"beta\":{\"raw\":1.1,\"fmt\":\"1.10\"},"
+              "\"fiftyTwoWeekChange\":{\"raw\":0.12,\"fmt\":\"12%%\"},\"SandP52WeekChange\":{\"raw\":0.08,\"fmt\":\"8%%\"}}");
+    } else {
+      bprintf(b, "\"%s\":{}", m);
+    }
+  }
+  bprintf(b, "}],\"error\":null}}");
+}
+
+static void option(Buffer *b, const char *s, int64_t expiry, double k, double p, char type, bool first)
+{
+  double intrinsic = type == 'C' ? p - k : k - p;
+  double last = (intrinsic > 0 ? intrinsic : 0) + p * 0.02;
+  bprintf(b, "%s{\"contractSymbol\":\"%s%ld%c%08ld\",\"strike\":%.2f,\"currency\":\"USD\",\"lastPrice\":%.2f,"
+          "\"change\":0.0,\"percentChange\":0.0,\"volume\":%d,\"openInterest\":%d,\"bid\":%.2f,\"ask\":%.2f,"
+          "\"contractSize\":\"REGULAR\",\"expiration\":%ld,\"lastTradeDate\":%ld,\"impliedVolatility\":0.3,"
+          "\"inTheMoney\":%s}",
+          first ? "" : ",", s, expiry, type, (long) (k * 1000), k, last, 100, 1000, last * 0.99, last * 1.01,
+          expiry, (int64_t) time(NULL), intrinsic > 0 ? "true" : "false");
+}
+
+static void options(Buffer *b, const char *s, const char *query)
+{
+  double p = price(s), step = p < 50 ? 1 : p < 200 ? 5 : 10;
+  int64_t today = time(NULL) / YQLD_DAY * YQLD_DAY;
+  int64_t expiry = today + (5 - (today / YQLD_DAY + 4) % 7 + 7) % 7 * YQLD_DAY; /* Next Friday */
+  char v[32];
+  if (param(query, "date", v, sizeof(v))) {
+    expiry = atoll(v);
+  }
+
+  bprintf(b, "{\"optionChain\":{\"result\":[{\"underlyingSymbol\":\"%s\",\"expirationDates\":[", s);
+  for (int i = 0; i < 8; i++) {
+    bprintf(b, i ? ",%ld" : "%ld", expiry + (int64_t) i * 7 * YQLD_DAY);
+  }
+  double k0 = ((int) (p / step) - strikes / 2) * step;
+  if (k0 < step) {
+    k0 = step;
+  }
+  bprintf(b, "],\"strikes\":[");
+  for (int i = 0; i < strikes; i++) {
+    bprintf(b, i ? ",%.2f" : "%.2f", k0 + i * step);
+  }
+  bprintf(b, "],\"hasMiniOptions\":false,\"quote\":{},\"options\":[{\"expirationDate\":%ld,\"hasMiniOptions\":false,\"calls\":[", expiry);
+  for (int i = 0; i < strikes; i++) {
+    option(b, s, expiry, k0 + i * step, p, 'C', i == 0);
+  }
+  bprintf(b, "],\"puts\":[");
+  for (int i = 0; i < strikes; i++) {
+    option(b, s, expiry, k0 + i * step, p, 'P', i == 0);
+  }
+  bprintf(b, "]}]}],\"error\":null}}");
+}
+
+static void download(Buffer *b, const char *s, const char *query)
+{
+  double previous = 0;
+  int n = range_bars(query);
+  struct Bar *r = walk(s, n, &previous);
+  bprintf(b, "Date,Open,High,Low,Close,Adj Close,Volume\n");
+  for (int i = 0; i < n; i++) {
+    char date[16];
+    time_t t = r[i].timestamp;
+    strftime(date, sizeof(date), "%Y-%m-%d", gmtime(&t));
+    bprintf(b, "%s,%.6f,%.6f,%.6f,%.6f,%.6f,%ld\n", date, r[i].open, r[i].high, r[i].low, r[i].close, r[i].close, r[i].volume);
+  }
+  free(r);
+}
+
+/* Fiscal years end in December; a period is reported 45 days after it ends */
+static void timeseries(Buffer *b, const char *s, const char *query)
+{
+  char types[4096] = "", v[32] = "";
+  int64_t period1 = param(query, "period1", v, sizeof(v)) ? atoll(v) : 0;
+  int64_t period2 = param(query, "period2", v, sizeof(v)) ? atoll(v) : time(NULL);
+  int64_t reported = time(NULL) - 45 * YQLD_DAY;
+  param(query, "type", types, sizeof(types));
+  urldecode(types);
+
+  time_t now = time(NULL);
+  struct tm tm;
+  gmtime_r(&now, &tm);
+  bprintf(b, "{\"timeseries\":{\"result\":[");
+  int i = 0;
+  for (char *t = strtok(types, ","); t; t = strtok(NULL, ","), i++) {
+    bool annual = strncmp(t, "annual", 6) == 0;
+    uint64_t x = seed(t) ^ seed(s);
+    bprintf(b, "%s{\"meta\":{\"symbol\":[\"%s\"],\"type\":[\"%s\"]},\"timestamp\":[]", i ? "," : "", s, t);
+    int n = 0;
+    for (int k = annual ? 5 : 8; k >= 1; k--) {
+      struct tm e = { .tm_year = tm.tm_year - (annual ? k : 0), .tm_mon = annual ? 12 : tm.tm_mon / 3 * 3 - 3 * (k - 1), .tm_mday = 0 };
+      time_t end = timegm(&e);
+      if (end < period1 || end > period2 || end > reported) {
+        continue;
+      }
+      char date[16];
+      strftime(date, sizeof(date), "%Y-%m-%d", gmtime(&end));
+      double value = 1e9 * (1 + uniform(&x)) * (annual ? 4 : 1);
+      bprintf(b, n ? "," : ",\"%s\":[", t);
+      bprintf(b, "{\"dataId\":%d,\"asOfDate\":\"%s\",\"periodType\":\"%s\",\"currencyCode\":\"USD\","
+              "\"reportedValue\":{\"raw\":%.0f,\"fmt\":\"%.2fB\"}}",
+              n, date, annual ? "12M" : "3M", value, value / 1e9);
+      n++;
+    }
+    bprintf(b, n ? "]}" : "}");
+  }
+  bprintf(b, "],\"error\":null}}");
+}
+
+static void headline(Buffer *b, const char *query)
+{
+  char s[YQLD_SYMBOL + 1] = "YQLD";
+  param(query, "s", s, sizeof(s));
+  time_t now = time(NULL) / 3600 * 3600;
+  bprintf(b, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<rss version=\"2.0\"><channel>"
+          "<title>Yahoo! Finance: %s News</title>", s);
+  for (int i = 0; i < YQLD_HEADLINES; i++) {
+    char date[64];
+    time_t t = now - i * 3600;
+    strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S +0000", gmtime(&t));
+    bprintf(b, "<item><description>Synthetic story %d about %s.</description><guid isPermaLink=\"false\">%s-%ld</guid>"
+            "<link>http://127.0.0.1/%s/%ld</link><pubDate>%s</pubDate><title>%s headline %d</title></item>",
+            i, s, s, (long) t, s, (long) t, date, s, i);
+  }
+  bprintf(b, "</channel></rss>\n");
+}
+
+static void labstat(Buffer *b, const char *path)
+{
+  const char *id = strstr(path, "/cu/") ? "CUUR0000SA0" : strstr(path, "/cw/") ? "CWUR0000SA0" : "WPU00000000";
+  uint64_t x = seed(id);
+  double v = 100;
+  bprintf(b, "series_id\tyear\tperiod\tvalue\tfootnote_codes\r\n");
+  for (int year = 1990; year <= 2025; year++) {
+    for (int m = 1; m <= 13; m++) {
+      v *= m < 13 ? 1 + 0.006 * uniform(&x) : 1;
+      bprintf(b, "%-17s\t%d\tM%02d\t%12.3f\t\r\n", id, year, m, v);
+    }
+  }
+}
+
+/* BLS API: the monthly data points of the series posted, latest first, walking as labstat() */
+static void blsapi(Buffer *b, const char *payload)
+{
+  static const char * const months[] = {
+    "January", "February", "March", "April", "May", "June",
+    "July", "August", "September", "October", "November", "December",
+  };
+  int since = 1990, until = 2025;
+  const char *p = strstr(payload, "\"startyear\"");
+  if (p) {
+    sscanf(p, "\"startyear\" : \"%d\"", &since);
+  }
+  if ((p = strstr(payload, "\"endyear\""))) {
+    sscanf(p, "\"endyear\" : \"%d\"", &until);
+  }
+  since = since < 1990 ? 1990 : since;
+  until = until > 2100 ? 2100 : until;
+
+  bprintf(b, "{\"status\":\"REQUEST_SUCCEEDED\",\"responseTime\":1,\"message\":[],\"Results\":{\"series\":[");
+  p = strstr(payload, "\"seriesid\"");
+  p = p ? strchr(p, '[') : NULL;
+  const char *end = p ? strchr(p, ']') : NULL;
+  for (bool first = true; end && (p = strchr(p + 1, '"')) && p < end; first = false) {
+    char id[YQLD_SYMBOL + 1];
+    size_t n = strcspn(++p, "\"");
+    snprintf(id, sizeof(id), "%.*s", (int) n, p);
+    p += n;
+
+    int years = until >= 1990 ? until - 1990 + 1 : 0;
+    double *v = calloc(years > 0 ? years * 12 : 1, sizeof(double));
+    uint64_t x = seed(id);
+    double w = 100;
+    for (int i = 0; i < years * 12; i++) {
+      v[i] = w *= 1 + 0.006 * uniform(&x);
+    }
+    bprintf(b, "%s{\"seriesID\":\"%s\",\"data\":[", first ? "" : ",", id);
+    for (int i = years * 12 - 1; i >= (since - 1990) * 12; i--) {
+      bprintf(b, "%s{\"year\":\"%d\",\"period\":\"M%02d\",\"periodName\":\"%s\",\"value\":\"%.3f\",\"footnotes\":[{}]}",
+              i == years * 12 - 1 ? "" : ",", 1990 + i / 12, i % 12 + 1, months[i % 12], v[i]);
+    }
+    bprintf(b, "]}");
+    free(v);
+  }
+  bprintf(b, "]}}");
+}
+
+/**
+ * Routes path?query, with the body of a POST in payload, to an endpoint,
+ * returning the content type, or NULL for an unknown path.
+ */
+static const char *route(Buffer *b, char *target, const char *payload)
+{
+  char *query = strchr(target, '?');
+  if (query) {
+    *query++ = 0;
+  } else {
+    query = "";
+  }
+
+  char s[YQLD_SYMBOL + 1] = "";
+  const char *p = NULL;
+  if (strcmp(target, "/v7/finance/quote") == 0) {
+    quotes(b, query);
+  } else if (strcmp(target, "/v7/finance/spark") == 0) {
+    spark(b, query);
+  } else if ((p = strstr(target, "/finance/chart/"))) {
+    snprintf(s, sizeof(s), "%s", p + strlen("/finance/chart/")), urldecode(s);
+    chart(b, s, query);
+  } else if ((p = strstr(target, "/finance/quoteSummary/"))) {
+    snprintf(s, sizeof(s), "%s", p + strlen("/finance/quoteSummary/")), urldecode(s);
+    quoteSummary(b, s, query);
+  } else if ((p = strstr(target, "/finance/options/"))) {
+    snprintf(s, sizeof(s), "%s", p + strlen("/finance/options/")), urldecode(s);
+    options(b, s, query);
+  } else if ((p = strstr(target, "/finance/timeseries/"))) {
+    snprintf(s, sizeof(s), "%s", p + strlen("/finance/timeseries/")), urldecode(s);
+    timeseries(b, s, query);
+  } else if ((p = strstr(target, "/finance/download/"))) {
+    snprintf(s, sizeof(s), "%s", p + strlen("/finance/download/")), urldecode(s);
+    download(b, s, query);
+    return "text/csv";
+  } else if (strstr(target, "/rss/2.0/headline")) {
+    headline(b, query);
+    return "application/rss+xml";
+  } else if (strstr(target, "/pub/time.series/")) {
+    labstat(b, target);
+    return "text/plain";
+  } else if (strstr(target, "/publicAPI/") && strstr(target, "/timeseries/data")) {
+    blsapi(b, payload);
+  } else {
+    return NULL;
+  }
+  return "application/json";
+}
+
+static bool send_all(int fd, const char *p, size_t n)
+{
+  while (n > 0) {
+    ssize_t k = send(fd, p, n, MSG_NOSIGNAL);
+    if (k <= 0) {
+      return false;
+    }
+    p += k, n -= k;
+  }
+  return true;
+}
+
+static void *serve(void *arg)
+{
+  int fd = (int) (intptr_t) arg;
+  char *request = malloc(YQLD_REQUEST + 1);
+  Buffer body = { NULL, 0, 0 }, head = { NULL, 0, 0 };
+  size_t size = 0;
+
+  for (;;) {
+    char *end = NULL;
+    while (!(end = size ? strstr(request, "\r\n\r\n") : NULL)) {
+      if (size == YQLD_REQUEST) {
+        goto CLOSE;
+      }
+      ssize_t k = recv(fd, request + size, YQLD_REQUEST - size, 0);
+      if (k <= 0) {
+        goto CLOSE;
+      }
+      size += k;
+      request[size] = 0;
+    }
+
+    char method[8], target[YQLD_REQUEST];
+    if (sscanf(request, "%7s %16383s", method, target) != 2) {
+      goto CLOSE;
+    }
+    const char *connection = header(request, "Connection");
+    bool close = connection && strncasecmp(connection, "close", 5) == 0;
+
+    /* The body, by Content-Length; curl holds back a larger one until told to continue */
+    char *payload = end + 4;
+    const char *length = header(request, "Content-Length");
+    size_t used = payload - request + (length ? strtoul(length, NULL, 10) : 0);
+    if (used > YQLD_REQUEST) {
+      goto CLOSE;
+    }
+    const char *expect = header(request, "Expect");
+    if (size < used && expect && strncasecmp(expect, "100-continue", 12) == 0 &&
+        !send_all(fd, "HTTP/1.1 100 Continue\r\n\r\n", 25)) {
+      goto CLOSE;
+    }
+    while (size < used) {
+      ssize_t k = recv(fd, request + size, YQLD_REQUEST - size, 0);
+      if (k <= 0) {
+        goto CLOSE;
+      }
+      size += k;
+      request[size] = 0;
+    }
+    char next = request[used];
+    request[used] = 0;
+
+    body.size = head.size = 0;
+    const char *type = route(&body, target, payload);
+    request[used] = next;
+    if (delay) {
+      usleep(delay * 1000);
+    }
+    if (type) {
+      bprintf(&head, "HTTP/1.1 200 OK\r\nContent-Type: %s\r\nContent-Length: %zu\r\n%s\r\n",
+              type, body.size, close ? "Connection: close\r\n" : "");
+    } else {
+      body.size = 0;
+      bprintf(&body, "404 Not Found: %s\n", target);
+      bprintf(&head, "HTTP/1.1 404 Not Found\r\nContent-Type: text/plain\r\nContent-Length: %zu\r\n\r\n", body.size);
+    }
+    if (!send_all(fd, head.data, head.size) || (strcmp(method, "HEAD") != 0 && !send_all(fd, body.data, body.size)) || close) {
+      goto CLOSE;
+    }
+
+    size -= used; /* Keep any pipelined request */
+    memmove(request, request + used, size + 1);
+  }
+
+CLOSE:
+  close(fd);
+  free(head.data);
+  free(body.data);
+  free(request);
+  return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+  int port = YQLD_PORT, opt = 0;
+  while ((opt = getopt(argc, argv, "p:n:k:d:")) != -1) {
+    switch (opt) {
+    case 'p':
+      port = atoi(optarg);
+      break;
+    case 'n':
+      bars = atoi(optarg);
+      break;
+    case 'k':
+      strikes = atoi(optarg);
+      break;
+    case 'd':
+      delay = atoi(optarg);
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-p port] [-n bars] [-k strikes] [-d delay_ms]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  signal(SIGPIPE, SIG_IGN);
+
+  int sfd = socket(AF_INET, SOCK_STREAM, 0), on = 1;
+  setsockopt(sfd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(port), .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+  if (sfd < 0 || bind(sfd, (struct sockaddr *) &addr, sizeof(addr)) != 0 || listen(sfd, SOMAXCONN) != 0) {
+    perror("yqld");
+    return EXIT_FAILURE;
+  }
+  fprintf(stderr, "yqld: listening on http://127.0.0.1:%d\n", port);
+
+  for (;;) {
+    int fd = accept(sfd, NULL, NULL);
+    if (fd < 0) {
+      if (errno != EINTR) {
+        perror("accept");
+      }
+      continue;
+    }
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, serve, (void *) (intptr_t) fd) != 0) {
+      close(fd);
+      continue;
+    }
+    pthread_detach(thread);
+  }
+}